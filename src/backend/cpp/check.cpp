@@ -6,22 +6,28 @@
 #include "evaluator.hpp"
 
 template <template <typename> class Trig>
-bool equations_positive(const std::vector<std::tuple<EqVec<Trig>, Coeff64, Coeff64>>& eqs, const PointQ& center, const Rational& radius, Evaluator& eval) {
+bool equations_positive(const EquationArena<Trig>& eqs, const PointQ& center, const Rational& radius, Evaluator& eval) {
 
-    for (const auto& tup : eqs) {
+    for (size_t i = 0; i < eqs.size(); ++i) {
 
-        const auto& eq = std::get<0>(tup);
-        const auto bx = std::get<1>(tup);
-        const auto by = std::get<2>(tup);
+        const auto eq = eqs[i];
 
-        const auto pos = eval.is_positive(eq, bx + by, center, radius);
+        const auto pos = eval.is_positive(eq, center, radius, radius);
 
         if (!pos) {
             std::cout << "Failure: not positive" << std::endl;
             std::cout << "f(x, y) = " << eq << std::endl;
-            std::cout << "bound = " << (bx + by) << std::endl;
+            std::cout << "bound = " << (eq.bx() + eq.by()) << std::endl;
             std::cout << "center = " << center << std::endl;
             std::cout << "radius = " << radius << std::endl;
+
+            // How far off the first order test was, for seeing how much to subdivide
+            const auto margin = eval.margin(eq, center, radius, radius);
+
+            if (margin) {
+                std::cout << "margin = " << *margin << std::endl;
+            }
+
             return false;
         }
     }
@@ -36,12 +42,18 @@ static bool covers_square(const StableInfo& info, const ClosedRectangleQ& square
         return false;
     }
 
-    Evaluator eval{bits};
+    auto& eval = thread_evaluator(bits);
 
     const auto center = square.center();
     // It's a square, so we can use width or height
     const Rational radius = square.width() / 2;
 
+    // Share the trig terms between all the equations. Only if that fails do we go through
+    // them one at a time, to find the one that is not positive.
+    if (eval.all_positive(info, center, radius, radius)) {
+        return true;
+    }
+
     if (!equations_positive(info.sines, center, radius, eval)) {
         std::cout << "not all sines positive" << std::endl;
         return false;
@@ -65,9 +77,10 @@ static uint32_t digits_to_bits(const uint32_t digits) {
 }
 
 std::string check_square(const int64_t numerx, const int64_t numery, const int64_t denom, const CodeSequence& code_seq,
-                         const InitialAngles& initial_angles, const std::string& cover_dir) {
+                         const InitialAngles& initial_angles, const std::string& cover_dir,
+                         const InfoStore* const store) {
 
-    const StableInfo code_info{calculate_code_info(CodePair{code_seq, initial_angles})};
+    const auto code_info = calculate_single_info(CodePair{code_seq, initial_angles}, store);
 
     const Rational cx = Rational{numerx} / denom;
     const Rational cy = Rational{numery} / denom;
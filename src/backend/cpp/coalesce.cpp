@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include <tbb/concurrent_hash_map.h>
+#include <tbb/parallel_for.h>
+
+#include "coalesce.hpp"
+#include "progress.hpp"
+
+// The infos of the codes that coalesce_cover tries, calculated the first time they are needed.
+// Unlike InfoCache, nothing is freed, since we can't tell in advance which codes a Divide
+// further up will try again.
+template <typename Info, typename Pair>
+class LazyInfos final {
+
+  private:
+    using Table = tbb::concurrent_hash_map<size_t, std::shared_ptr<const Info>>;
+
+    const std::vector<Pair>& pairs;
+    Info (*const calculate)(const Pair&, const InfoStore*);
+    const InfoStore* const store;
+
+    Table table;
+
+  public:
+    explicit LazyInfos(const std::vector<Pair>& pairs_, Info (*const calculate_)(const Pair&, const InfoStore*),
+                       const InfoStore* const store_)
+        : pairs{pairs_},
+          calculate{calculate_},
+          store{store_} {}
+
+    std::shared_ptr<const Info> get(const size_t index) {
+
+        // Anyone else after the same code waits for it to be calculated
+        typename Table::accessor accessor{};
+
+        if (table.insert(accessor, index) || !accessor->second) {
+            accessor->second = std::make_shared<const Info>(calculate(pairs.at(index), store));
+        }
+
+        return accessor->second;
+    }
+};
+
+// What every Coalescer shares
+struct CoalesceContext final {
+    const OpenConvexPolygonQ& polygon;
+    const std::vector<TriplePair>& triples;
+    const uint32_t digits;
+    const VerifyOptions& options;
+
+    LazyInfos<StableInfo, CodePair> singles;
+    LazyInfos<TripleInfo, TriplePair> triple_infos;
+
+    std::atomic<uint64_t> merged;
+
+    Progress& progress;
+};
+
+// The codes of the quarters, the ones that cover the most quarters first. Ties go to the lowest
+// index, so that the result does not depend on the order of the quarters.
+template <typename Leaf>
+static std::vector<size_t> candidates(const std::vector<cover::Cover>& quarters) {
+
+    std::map<size_t, size_t> counts{};
+
+    for (const auto& quarter : quarters) {
+        if (const auto* const leaf = boost::get<Leaf>(&quarter)) {
+            ++counts[leaf->index];
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> sorted(std::begin(counts), std::end(counts));
+
+    std::stable_sort(std::begin(sorted), std::end(sorted), [](const auto& lhs, const auto& rhs) {
+        return lhs.second > rhs.second;
+    });
+
+    std::vector<size_t> indices{};
+
+    for (const auto& kv : sorted) {
+        indices.push_back(kv.first);
+    }
+
+    return indices;
+}
+
+class Coalescer final : public boost::static_visitor<cover::Cover> {
+
+  private:
+    const ClosedRectangleQ& square;
+    CoalesceContext& context;
+
+    // The leaf that can replace the quarters on the whole square, if there is one
+    boost::optional<cover::Cover> merge(const std::vector<cover::Cover>& quarters) const {
+
+        const auto is_divide = [](const cover::Cover& quarter) {
+            return boost::get<cover::Divide>(&quarter) != nullptr;
+        };
+
+        if (std::any_of(std::begin(quarters), std::end(quarters), is_divide)) {
+            return boost::none;
+        }
+
+        const auto is_empty = [](const cover::Cover& quarter) {
+            return boost::get<cover::Empty>(&quarter) != nullptr;
+        };
+
+        if (std::all_of(std::begin(quarters), std::end(quarters), is_empty)) {
+
+            if (geometry::intersects(square, context.polygon)) {
+                return boost::none;
+            }
+
+            return cover::Cover{cover::Empty{}};
+        }
+
+        // Singles are far cheaper to check than triples, so they go first
+        for (const auto index : candidates<cover::Single>(quarters)) {
+            if (single_covers_square(*context.singles.get(index), square, context.digits, context.options)) {
+                return cover::Cover{cover::Single{index}};
+            }
+        }
+
+        for (const auto index : candidates<cover::Triple>(quarters)) {
+            if (triple_covers_square(*context.triple_infos.get(index), context.triples.at(index), square,
+                                     context.digits, context.options)) {
+                return cover::Cover{cover::Triple{index}};
+            }
+        }
+
+        return boost::none;
+    }
+
+  public:
+    explicit Coalescer(const ClosedRectangleQ& square_, CoalesceContext& context_)
+        : square{square_},
+          context{context_} {}
+
+    cover::Cover operator()(const cover::Empty empty) const {
+        ++context.progress;
+        return empty;
+    }
+
+    cover::Cover operator()(const cover::Single& single) const {
+        ++context.progress;
+        return single;
+    }
+
+    cover::Cover operator()(const cover::Triple& triple) const {
+        ++context.progress;
+        return triple;
+    }
+
+    cover::Cover operator()(const cover::Divide& divide) const {
+
+        const auto quarter_squares = subdivide(square);
+        const auto& quarter_covers = divide.quarters.get();
+
+        std::vector<cover::Cover> quarters(4);
+
+        // The quarters are independent, and tbb balances the nested loops
+        tbb::parallel_for(size_t{0}, size_t{4}, [&](const size_t i) {
+            quarters.at(i) = boost::apply_visitor(Coalescer{quarter_squares.at(i), context}, quarter_covers.at(i));
+        });
+
+        if (auto merged = merge(quarters)) {
+            ++context.merged;
+            return std::move(*merged);
+        }
+
+        return cover::Divide{std::move(quarters.at(0)), std::move(quarters.at(1)),
+                             std::move(quarters.at(2)), std::move(quarters.at(3))};
+    }
+};
+
+cover::Cover coalesce_cover(const ClosedRectangleQ& square, const OpenConvexPolygonQ& polygon,
+                            const std::vector<CodePair>& singles,
+                            const std::vector<TriplePair>& triples,
+                            const cover::Cover& cover,
+                            const uint32_t digits,
+                            const VerifyOptions& options,
+                            const InfoStore* const store,
+                            CoalesceStats& stats) {
+
+    stats.leaves_before = count_leaves(cover);
+
+    cover::Cover coalesced{};
+
+    {
+        Progress progress{"Coalescing cover: ", stats.leaves_before};
+
+        CoalesceContext context{polygon, triples, digits, options,
+                                LazyInfos<StableInfo, CodePair>{singles, calculate_single_info, store},
+                                LazyInfos<TripleInfo, TriplePair>{triples, calculate_triple_info, store},
+                                {0},
+                                progress};
+
+        coalesced = boost::apply_visitor(Coalescer{square, context}, cover);
+
+        stats.merged = context.merged;
+    }
+
+    stats.leaves_after = count_leaves(coalesced);
+
+    return coalesced;
+}
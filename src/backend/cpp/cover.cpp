@@ -1,3 +1,5 @@
+#include <fstream>
+
 #include <boost/algorithm/string.hpp>
 
 #include "cover.hpp"
@@ -228,6 +230,54 @@ cover::Cover load_cover(const std::string& dir) {
     return parse_cover(iter);
 }
 
+class WriteCover final : public boost::static_visitor<void> {
+
+  private:
+    std::ostream& os;
+
+  public:
+    explicit WriteCover(std::ostream& os_)
+        : os{os_} {}
+
+    void operator()(const cover::Empty) const {
+        os << "E";
+    }
+
+    void operator()(const cover::Single& single) const {
+        os << "S " << single.index;
+    }
+
+    void operator()(const cover::Triple& triple) const {
+        os << "T " << triple.index;
+    }
+
+    void operator()(const cover::Divide& divide) const {
+
+        os << "D";
+
+        for (const auto& quarter : divide.quarters.get()) {
+            os << ' ';
+            boost::apply_visitor(*this, quarter);
+        }
+    }
+};
+
+void save_cover(const std::string& file, const cover::Cover& cover) {
+
+    std::ofstream output{file};
+
+    boost::apply_visitor(WriteCover{output}, cover);
+    output << '\n';
+
+    output.flush();
+
+    if (!output) {
+        std::ostringstream err{};
+        err << "save_cover: could not write " << file;
+        throw std::runtime_error(err.str());
+    }
+}
+
 uint32_t load_digits(const std::string& dir) {
 
     // TODO change this to digits.txt
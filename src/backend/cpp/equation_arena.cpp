@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include "equation_arena.hpp"
+
+CoeffWidth narrowest_width(const Coeff64 max_abs) {
+
+    if (max_abs <= std::numeric_limits<int8_t>::max()) {
+        return CoeffWidth::Int8;
+    } else if (max_abs <= std::numeric_limits<int16_t>::max()) {
+        return CoeffWidth::Int16;
+    } else if (max_abs <= std::numeric_limits<int32_t>::max()) {
+        return CoeffWidth::Int32;
+    } else {
+        std::ostringstream oss{};
+        oss << "narrowest_width: coefficient too large " << max_abs;
+        throw std::runtime_error(oss.str());
+    }
+}
+
+template <template <typename> class Trig>
+EquationArena<Trig>::EquationArena(const std::set<EqMap<Trig>>& equations, const CoeffWidth width)
+    : width_{width},
+      precision_{64} {
+
+    offsets.push_back(0);
+
+    for (const auto& equation : equations) {
+
+        switch (width_) {
+        case CoeffWidth::Int8:
+            push_back(terms8, equation);
+            break;
+        case CoeffWidth::Int16:
+            push_back(terms16, equation);
+            break;
+        case CoeffWidth::Int32:
+            push_back(terms32, equation);
+            break;
+        }
+    }
+}
+
+template <template <typename> class Trig>
+template <typename Coeff>
+void EquationArena<Trig>::push_back(PackedTerms<Coeff>& terms, const EqMap<Trig>& equation) {
+
+    uint32_t max_x = 0;
+    uint32_t max_y = 0;
+
+    // At a precision of p bits, each term is off by roughly |t| * (1 + |x| + |y|) * 2^-p:
+    // the error in the trig function itself, plus the error in its argument.
+    double scale = 1;
+
+    for (const auto& kv : equation) {
+
+        const auto x_coeff = kv.first.arg.coeff(XY::X);
+        const auto y_coeff = kv.first.arg.coeff(XY::Y);
+
+        terms.t.push_back(boost::numeric_cast<Coeff>(kv.second));
+        terms.x.push_back(boost::numeric_cast<Coeff>(x_coeff));
+        terms.y.push_back(boost::numeric_cast<Coeff>(y_coeff));
+
+        max_x = std::max(max_x, static_cast<uint32_t>(math::abs(static_cast<Coeff64>(x_coeff))));
+        max_y = std::max(max_y, static_cast<uint32_t>(math::abs(static_cast<Coeff64>(y_coeff))));
+
+        scale += std::abs(static_cast<double>(kv.second)) *
+                 (1 + std::abs(static_cast<double>(x_coeff)) + std::abs(static_cast<double>(y_coeff)));
+    }
+
+    // The equations that get this far have a margin too small for the double prefilter, so
+    // give them 64 bits on top of what the coefficients use up
+    precision_ = std::max(precision_, 64 + static_cast<uint32_t>(std::ceil(std::log2(scale))));
+
+    offsets.push_back(boost::numeric_cast<uint32_t>(terms.t.size()));
+
+    const auto gbounds = gradient_bounds(equation);
+
+    bx_.push_back(gbounds.first);
+    by_.push_back(gbounds.second);
+    max_x_.push_back(max_x);
+    max_y_.push_back(max_y);
+}
+
+template <template <typename> class Trig>
+EqMap<Trig> EquationView<Trig>::to_map() const {
+
+    EqMap<Trig> eq{};
+
+    for (const auto term : *this) {
+        const LinComArrZ<XY> arg{static_cast<Coeff32>(term.x), static_cast<Coeff32>(term.y)};
+        eq.add(static_cast<Coeff32>(term.t), Trig<LinComArrZ<XY>>{arg});
+    }
+
+    return eq;
+}
+
+template class EquationArena<Sin>;
+template class EquationArena<Cos>;
+
+template class EquationView<Sin>;
+template class EquationView<Cos>;
@@ -3,6 +3,7 @@
 
 #include "division.hpp"
 #include "equations.hpp"
+#include "info_store.hpp"
 #include "progress.hpp"
 #include "region.hpp"
 #include "shooting_vectors.hpp"
@@ -329,6 +330,27 @@ static CodeInfo calculate_unstable_code_info(const CodePair& code_pair, const Co
     return CodeInfo{segment, equations.first, equations.second};
 }
 
+template <template <typename> class Trig>
+static Coeff64 max_abs_coeff(const std::set<EqMap<Trig>>& equations) {
+
+    Coeff64 max_abs = 0;
+
+    for (const auto& equation : equations) {
+        for (const auto& kv : equation) {
+            max_abs = std::max(max_abs, math::abs(static_cast<Coeff64>(kv.second)));
+            max_abs = std::max(max_abs, math::abs(static_cast<Coeff64>(kv.first.arg.coeff(XY::X))));
+            max_abs = std::max(max_abs, math::abs(static_cast<Coeff64>(kv.first.arg.coeff(XY::Y))));
+        }
+    }
+
+    return max_abs;
+}
+
+CoeffWidth coeff_width(const CodeInfo& code_info) {
+    return narrowest_width(std::max(max_abs_coeff(code_info.sin_equations),
+                                    max_abs_coeff(code_info.cos_equations)));
+}
+
 CodeInfo calculate_code_info(const CodePair& code_pair) {
     const auto code_type = code_pair.sequence.type();
     if (is_stable(code_type)) {
@@ -338,7 +360,45 @@ CodeInfo calculate_code_info(const CodePair& code_pair) {
     }
 }
 
-std::map<size_t, std::pair<CodePair, StableInfo>> load_single_infos(const std::vector<CodePair>& singles) {
+TripleCodeInfo calculate_triple_code_info(const TriplePair& triple) {
+
+    auto stable_neg_info = calculate_code_info(triple.stable_neg);
+    auto unstable_info = calculate_code_info(triple.unstable);
+    auto stable_pos_info = calculate_code_info(triple.stable_pos);
+
+    remove_factor(stable_neg_info, triple.unstable, stable_pos_info);
+
+    return TripleCodeInfo{std::move(stable_neg_info), std::move(unstable_info), std::move(stable_pos_info)};
+}
+
+StableInfo calculate_single_info(const CodePair& single, const InfoStore* const store) {
+
+    if (store != nullptr) {
+        if (const auto code_info = store->code_info(single)) {
+            return StableInfo{*code_info};
+        }
+    }
+
+    return StableInfo{calculate_code_info(single)};
+}
+
+TripleInfo calculate_triple_info(const TriplePair& triple, const InfoStore* const store) {
+
+    boost::optional<TripleCodeInfo> code_info{};
+
+    if (store != nullptr) {
+        code_info = store->triple_code_info(triple);
+    }
+
+    if (!code_info) {
+        code_info = calculate_triple_code_info(triple);
+    }
+
+    return TripleInfo{StableInfo{code_info->stable_neg}, UnstableInfo{code_info->unstable}, StableInfo{code_info->stable_pos}};
+}
+
+std::map<size_t, std::pair<CodePair, StableInfo>> load_single_infos(const std::vector<CodePair>& singles,
+                                                                    const InfoStore* const store) {
 
     std::mutex mut{};
     std::map<size_t, std::pair<CodePair, StableInfo>> single_infos{};
@@ -350,8 +410,7 @@ std::map<size_t, std::pair<CodePair, StableInfo>> load_single_infos(const std::v
 
         const auto& stable = singles.at(index);
 
-        const auto code_info = calculate_code_info(stable);
-        StableInfo stable_info{code_info};
+        auto stable_info = calculate_single_info(stable, store);
 
         std::lock_guard<std::mutex> lock{mut};
         single_infos.emplace(index, std::make_pair(stable, std::move(stable_info)));
@@ -364,7 +423,8 @@ std::map<size_t, std::pair<CodePair, StableInfo>> load_single_infos(const std::v
     return single_infos;
 }
 
-std::map<size_t, std::pair<TriplePair, TripleInfo>> load_triple_infos(const std::vector<TriplePair>& triples) {
+std::map<size_t, std::pair<TriplePair, TripleInfo>> load_triple_infos(const std::vector<TriplePair>& triples,
+                                                                      const InfoStore* const store) {
 
     std::mutex mut{};
     std::map<size_t, std::pair<TriplePair, TripleInfo>> triple_infos{};
@@ -376,13 +436,7 @@ std::map<size_t, std::pair<TriplePair, TripleInfo>> load_triple_infos(const std:
 
         const auto& triple = triples.at(index);
 
-        auto stable_neg_info = calculate_code_info(triple.stable_neg);
-        const auto unstable_info = calculate_code_info(triple.unstable);
-        auto stable_pos_info = calculate_code_info(triple.stable_pos);
-
-        remove_factor(stable_neg_info, triple.unstable, stable_pos_info);
-
-        TripleInfo triple_info{StableInfo{stable_neg_info}, UnstableInfo{unstable_info}, StableInfo{stable_pos_info}};
+        auto triple_info = calculate_triple_info(triple, store);
 
         std::lock_guard<std::mutex> lock{mut};
         triple_infos.emplace(index, std::make_pair(triple, std::move(triple_info)));
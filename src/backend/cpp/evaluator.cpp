@@ -1,4 +1,10 @@
+#include <memory>
+#include <mutex>
+
 #include "evaluator.hpp"
+#include "equations.hpp"
+#include "math/complex_interval.hpp"
+#include "math/double_interval.hpp"
 
 struct FreeCache {
 
@@ -14,6 +20,25 @@ static const thread_local FreeCache free_cache{};
 // and then rounds as requested to the precise number of bits. In particular, rounding will
 // always be within 1 ULP
 
+// rop = half_pi * frac, rounded in the given direction.
+//
+// Every square in a cover is dyadic, and hence so are the fractions we multiply by. In that
+// case we avoid mpfr_mul_q, which has to divide by the denominator. Multiplying by a power of
+// two is exact, so this gives exactly the same result.
+static void mul_frac(mpfr_t rop, const mpfr_t half_pi, const mpq_t frac, const mpfr_rnd_t rnd) {
+
+    const auto den = mpq_denref(frac);
+
+    if (mpz_popcount(den) == 1) {
+        const auto exp = mpz_scan1(den, 0);
+
+        mpfr_mul_z(rop, half_pi, mpq_numref(frac), rnd);
+        mpfr_mul_2si(rop, rop, -static_cast<long>(exp), rnd);
+    } else {
+        mpfr_mul_q(rop, half_pi, frac, rnd);
+    }
+}
+
 template <template <typename> class Trig>
 void eval_trig_helper(mpfr_t term, const Coeff64 coeff, const mpq_t frac,
                       const mpfr_t half_pi_d, const mpfr_t half_pi_u);
@@ -27,7 +52,7 @@ void eval_trig_helper<Sin>(mpfr_t term, const Coeff64 coeff, const mpq_t frac,
     if (coeff > 0) {
 
         // Round down the argument
-        mpfr_mul_q(term, half_pi_d, frac, MPFR_RNDD);
+        mul_frac(term, half_pi_d, frac, MPFR_RNDD);
 
         // In the directed rounding modes, MPFR will always round each result
         // to the closest representable float in the given direction.
@@ -41,7 +66,7 @@ void eval_trig_helper<Sin>(mpfr_t term, const Coeff64 coeff, const mpq_t frac,
     } else if (coeff < 0) {
 
         // Round up the argument
-        mpfr_mul_q(term, half_pi_u, frac, MPFR_RNDU);
+        mul_frac(term, half_pi_u, frac, MPFR_RNDU);
 
         // This case is not as simple as the above one.
         // In the above multiplication, recall that 0 <= frac < 1. Ideally,
@@ -81,7 +106,7 @@ void eval_trig_helper<Cos>(mpfr_t term, const Coeff64 coeff, const mpq_t frac,
     if (coeff > 0) {
 
         // Round up the argument
-        mpfr_mul_q(term, half_pi_u, frac, MPFR_RNDU);
+        mul_frac(term, half_pi_u, frac, MPFR_RNDU);
 
         // Same as with the sin case
         if (mpfr_greater_p(term, half_pi_d)) {
@@ -95,7 +120,7 @@ void eval_trig_helper<Cos>(mpfr_t term, const Coeff64 coeff, const mpq_t frac,
     } else if (coeff < 0) {
 
         // Round down the argument
-        mpfr_mul_q(term, half_pi_d, frac, MPFR_RNDD);
+        mul_frac(term, half_pi_d, frac, MPFR_RNDD);
 
         // Round up the trig function
         mpfr_cos(term, term, MPFR_RNDU);
@@ -165,7 +190,425 @@ void eval_trig<Cos>(mpfr_t term, const Coeff64 coeff, const mpq_t frac, const un
     }
 }
 
-Evaluator::Evaluator(const uint32_t prec) {
+// Before doing the (slow) rigorous MPFR calculation, we first try to prove positivity with
+// interval arithmetic over hardware doubles. This is just as rigorous, but is only precise to
+// about 1e-13 or so. Almost every equation is positive with a far larger margin than that,
+// so this decides nearly all of them. If the result is inconclusive, we fall back to MPFR.
+
+// An interval of doubles that contains the given rational
+static math::DoubleInterval to_interval(const Rational& rat) {
+    // mpq_get_d truncates, so the true value is always within one ULP of the result
+    return math::DoubleInterval::around(mpq_get_d(rat.backend().data()));
+}
+
+template <template <typename> class Trig>
+math::DoubleInterval trig_interval(const math::SinCosInterval& sin_cos);
+
+template <>
+math::DoubleInterval trig_interval<Sin>(const math::SinCosInterval& sin_cos) {
+    return sin_cos.sin;
+}
+
+template <>
+math::DoubleInterval trig_interval<Cos>(const math::SinCosInterval& sin_cos) {
+    return sin_cos.cos;
+}
+
+template <template <typename> class Trig>
+math::DoubleInterval power_interval(const math::ComplexInterval& power);
+
+template <>
+math::DoubleInterval power_interval<Sin>(const math::ComplexInterval& power) {
+    // sin(theta) = Im(e^{i*theta})
+    return power.im;
+}
+
+template <>
+math::DoubleInterval power_interval<Cos>(const math::ComplexInterval& power) {
+    // cos(theta) = Re(e^{i*theta})
+    return power.re;
+}
+
+// Returns false if the center cannot be represented with finite doubles
+bool Evaluator::set_double_center(const PointQ& center) {
+
+    x_double = to_interval(center.x);
+    y_double = to_interval(center.y);
+
+    if (!x_double.is_finite() || !y_double.is_finite()) {
+        return false;
+    }
+
+    if (mode == TrigMode::Powers) {
+
+        const auto x_sin_cos = math::sin_cos_half_pi(x_double);
+        const auto y_sin_cos = math::sin_cos_half_pi(y_double);
+
+        // e^{i*theta} = cos(theta) + i*sin(theta)
+        x_powers.reset(math::ComplexInterval{x_sin_cos.cos, x_sin_cos.sin});
+        y_powers.reset(math::ComplexInterval{y_sin_cos.cos, y_sin_cos.sin});
+
+        x_arrays.clear();
+        y_arrays.clear();
+        kernel_valid = true;
+    }
+
+    return true;
+}
+
+template <template <typename> class Trig>
+math::DoubleInterval derivative_interval(const math::SinCosInterval& sin_cos);
+
+template <>
+math::DoubleInterval derivative_interval<Sin>(const math::SinCosInterval& sin_cos) {
+    // sin' = cos
+    return sin_cos.cos;
+}
+
+template <>
+math::DoubleInterval derivative_interval<Cos>(const math::SinCosInterval& sin_cos) {
+    // cos' = -sin
+    return -sin_cos.sin;
+}
+
+template <template <typename> class Trig>
+math::DoubleInterval power_derivative(const math::ComplexInterval& power);
+
+template <>
+math::DoubleInterval power_derivative<Sin>(const math::ComplexInterval& power) {
+    // sin'(theta) = cos(theta) = Re(e^{i*theta})
+    return power.re;
+}
+
+template <>
+math::DoubleInterval power_derivative<Cos>(const math::ComplexInterval& power) {
+    // cos'(theta) = -sin(theta) = -Im(e^{i*theta})
+    return -power.im;
+}
+
+// The largest absolute value in the interval, as an (exact) interval
+static math::DoubleInterval magnitude(const math::DoubleInterval& val) {
+    const auto mag = std::max(std::abs(val.lower()), std::abs(val.upper()));
+    return math::DoubleInterval{mag, mag};
+}
+
+// The coefficients of a term t * trig((x * X + y * Y) * pi/2), so that the same loops work for
+// both the terms of an EqMap and those of an EquationView
+template <typename Term>
+static Coeff64 term_x(const Term& kv) {
+    return kv.first.arg.coeff(XY::X);
+}
+
+template <typename Term>
+static Coeff64 term_y(const Term& kv) {
+    return kv.first.arg.coeff(XY::Y);
+}
+
+template <typename Term>
+static Coeff64 term_t(const Term& kv) {
+    return kv.second;
+}
+
+static Coeff64 term_x(const PackedTerm& term) {
+    return term.x;
+}
+
+static Coeff64 term_y(const PackedTerm& term) {
+    return term.y;
+}
+
+static Coeff64 term_t(const PackedTerm& term) {
+    return term.t;
+}
+
+// Intervals containing the value and gradient of
+//
+//     f(x, y) = sum of t_coeff * trig(x_coeff * x * pi/2 + y_coeff * y * pi/2)
+//
+// at the current double center, as well as the curvature over the box with radii rx and ry.
+template <template <typename> class Trig, typename Eq>
+DoubleTaylor Evaluator::double_taylor(const Eq& eq, const math::DoubleInterval& rx, const math::DoubleInterval& ry) {
+
+    const math::DoubleInterval zero{0, 0};
+
+    DoubleTaylor taylor{zero, zero, zero, zero};
+
+    for (const auto& kv : eq) {
+
+        const auto x_coeff = term_x(kv);
+        const auto y_coeff = term_y(kv);
+        const auto t_coeff = term_t(kv);
+
+        // trig(arg) and trig'(arg)
+        auto trig = zero;
+        auto deriv = zero;
+
+        if (mode == TrigMode::Powers) {
+
+            // e^{i(a*x + b*y)*pi/2} = s^a * t^b
+            const auto power = x_powers(x_coeff) * y_powers(y_coeff);
+
+            trig = power_interval<Trig>(power);
+            deriv = power_derivative<Trig>(power);
+
+        } else {
+
+            const auto arg = x_coeff * x_double + y_coeff * y_double;
+
+            const auto sin_cos = math::sin_cos_half_pi(arg);
+
+            trig = trig_interval<Trig>(sin_cos);
+            deriv = derivative_interval<Trig>(sin_cos);
+        }
+
+        taylor.value = taylor.value + t_coeff * trig;
+
+        // The pi/2 of the chain rule is multiplied in at the end
+        const auto t_deriv = t_coeff * deriv;
+
+        taylor.dx = taylor.dx + x_coeff * t_deriv;
+        taylor.dy = taylor.dy + y_coeff * t_deriv;
+
+        // |t_coeff| * (|x_coeff| * rx + |y_coeff| * ry)^2
+        const auto spread = math::abs(x_coeff) * rx + math::abs(y_coeff) * ry;
+
+        taylor.curvature = taylor.curvature + math::abs(t_coeff) * (spread * spread);
+    }
+
+    const auto half_pi = math::half_pi_interval();
+
+    taylor.dx = taylor.dx * half_pi;
+    taylor.dy = taylor.dy * half_pi;
+    taylor.curvature = taylor.curvature * half_pi * half_pi;
+
+    return taylor;
+}
+
+template <template <typename> class Trig>
+bool is_sine();
+
+template <>
+bool is_sine<Sin>() {
+    return true;
+}
+
+template <>
+bool is_sine<Cos>() {
+    return false;
+}
+
+// The same as above, but with the SIMD kernel, which is much faster. The kernel needs the
+// power tables, so we only use it in TrigMode::Powers.
+template <template <typename> class Trig>
+DoubleTaylor Evaluator::double_taylor(const EquationView<Trig>& eq, const math::DoubleInterval& rx, const math::DoubleInterval& ry) {
+
+    if (mode != TrigMode::Powers || !kernel_valid) {
+        return double_taylor<Trig, EquationView<Trig>>(eq, rx, ry);
+    }
+
+    if (!x_arrays.extend(x_powers, eq.max_x()) || !y_arrays.extend(y_powers, eq.max_y())) {
+        kernel_valid = false;
+        return double_taylor<Trig, EquationView<Trig>>(eq, rx, ry);
+    }
+
+    // The kernel reads the coefficients straight out of the arena
+    const auto sums = eq.visit_terms([&](const auto& terms) {
+        return math::sum_terms(is_sine<Trig>(), terms, x_arrays, y_arrays, rx.upper(), ry.upper());
+    });
+
+    const auto finite = std::isfinite(sums.value) && std::isfinite(sums.value_error) &&
+                        std::isfinite(sums.dx) && std::isfinite(sums.dx_error) &&
+                        std::isfinite(sums.dy) && std::isfinite(sums.dy_error) &&
+                        std::isfinite(sums.curvature);
+
+    if (!finite) {
+        return double_taylor<Trig, EquationView<Trig>>(eq, rx, ry);
+    }
+
+    // Turn the error bounds into intervals
+    const auto interval = [](const double val, const double error) {
+        return math::DoubleInterval{math::DoubleInterval::down(val - error), math::DoubleInterval::up(val + error)};
+    };
+
+    const auto half_pi = math::half_pi_interval();
+
+    return DoubleTaylor{interval(sums.value, sums.value_error),
+                        interval(sums.dx, sums.dx_error) * half_pi,
+                        interval(sums.dy, sums.dy_error) * half_pi,
+                        math::DoubleInterval{0, math::DoubleInterval::up(sums.curvature)} * half_pi * half_pi};
+}
+
+// Returns true only if the equation was proved positive over the box around the current double
+// center. False means we don't know.
+//
+// There are two ways to prove this. The first order test is that f(c) is larger than the
+// Lipschitz bound (bx * rx + by * ry) * pi/2. The second order test uses Taylor's theorem with
+// the Lagrange form of the remainder,
+//
+//     f(c + d) = f(c) + grad f(c) . d + 1/2 d^T H(xi) d
+//
+// Each term of the Hessian is -t * trig(arg) * (pi/2)^2 * (a, b)^T (a, b), so
+//
+//     |d^T H d| <= (pi/2)^2 * sum of |t| * (|a| * rx + |b| * ry)^2
+//
+// and f is positive if f(c) - |f_x(c)| * rx - |f_y(c)| * ry - 1/2 of that bound is positive.
+// Since the gradient is usually much smaller than its Lipschitz bound (especially near the
+// minimum of f), this proves far larger squares.
+template <template <typename> class Trig, typename Eq>
+bool Evaluator::double_is_positive(const Eq& eq, const Coeff64 bx, const Coeff64 by,
+                                   const Rational& rx, const Rational& ry) {
+
+    const auto rx_double = to_interval(rx);
+    const auto ry_double = to_interval(ry);
+
+    if (!rx_double.is_finite() || !ry_double.is_finite()) {
+        return false;
+    }
+
+    const auto taylor = double_taylor<Trig>(eq, rx_double, ry_double);
+
+    // (bx * rx + by * ry) * pi/2
+    const auto bound = (bx * rx_double + by * ry_double) * math::half_pi_interval();
+
+    if (bound.is_finite() && taylor.value.lower() > bound.upper()) {
+        return true;
+    }
+
+    const auto linear = magnitude(taylor.dx) * rx_double + magnitude(taylor.dy) * ry_double;
+    const auto quadratic = math::DoubleInterval{0.5, 0.5} * taylor.curvature;
+
+    const auto lower = taylor.value - linear - quadratic;
+
+    return lower.is_finite() && lower.lower() > 0;
+}
+
+template <template <typename> class Trig>
+boost::optional<math::DoubleInterval> Evaluator::margin(const EquationView<Trig>& eq,
+                                                        const PointQ& center, const Rational& rx, const Rational& ry) {
+
+    const auto rx_double = to_interval(rx);
+    const auto ry_double = to_interval(ry);
+
+    if (!set_double_center(center) || !rx_double.is_finite() || !ry_double.is_finite()) {
+        return boost::none;
+    }
+
+    const auto taylor = double_taylor<Trig>(eq, rx_double, ry_double);
+
+    // (bx * rx + by * ry) * pi/2
+    const auto bound = (eq.bx() * rx_double + eq.by() * ry_double) * math::half_pi_interval();
+
+    const auto result = taylor.value - bound;
+
+    if (!result.is_finite()) {
+        return boost::none;
+    }
+
+    return result;
+}
+
+template boost::optional<math::DoubleInterval> Evaluator::margin(const EquationView<Sin>& eq,
+                                                               const PointQ& center, const Rational& rx, const Rational& ry);
+template boost::optional<math::DoubleInterval> Evaluator::margin(const EquationView<Cos>& eq,
+                                                               const PointQ& center, const Rational& rx, const Rational& ry);
+
+template <template <typename> class Trig>
+boost::optional<math::DoubleInterval> Evaluator::margin_along(const EquationView<Trig>& eq,
+                                                              const PointQ& center, const Rational& dx, const Rational& dy) {
+
+    const auto dx_double = to_interval(dx);
+    const auto dy_double = to_interval(dy);
+
+    if (!set_double_center(center) || !dx_double.is_finite() || !dy_double.is_finite()) {
+        return boost::none;
+    }
+
+    // The same bound as in double_is_positive_along
+    math::DoubleInterval lipschitz{0, 0};
+
+    for (const auto packed : eq) {
+        lipschitz = lipschitz + math::abs(packed.t) * magnitude(packed.x * dx_double + packed.y * dy_double);
+    }
+
+    const auto taylor = double_taylor<Trig>(eq, magnitude(dx_double), magnitude(dy_double));
+
+    const auto result = taylor.value - lipschitz * math::half_pi_interval();
+
+    if (!result.is_finite()) {
+        return boost::none;
+    }
+
+    return result;
+}
+
+template boost::optional<math::DoubleInterval> Evaluator::margin_along(const EquationView<Sin>& eq,
+                                                                     const PointQ& center, const Rational& dx, const Rational& dy);
+template boost::optional<math::DoubleInterval> Evaluator::margin_along(const EquationView<Cos>& eq,
+                                                                     const PointQ& center, const Rational& dx, const Rational& dy);
+
+// Lower and upper bounds on pi/2. These are important constants, so they have twice the
+// precision of the Evaluators that use them. Computing pi to thousands of bits is not cheap,
+// so they are only computed once per precision, and then shared read-only between threads.
+class HalfPi final {
+  private:
+    mpfr_t half_pi_d;
+    mpfr_t half_pi_u;
+
+    explicit HalfPi(const uint32_t prec) {
+
+        mpfr_init2(half_pi_d, 2 * prec);
+        mpfr_init2(half_pi_u, 2 * prec);
+
+        mpfr_const_pi(half_pi_d, MPFR_RNDD);
+        mpfr_const_pi(half_pi_u, MPFR_RNDU);
+
+        mpfr_div_ui(half_pi_d, half_pi_d, 2, MPFR_RNDD);
+        mpfr_div_ui(half_pi_u, half_pi_u, 2, MPFR_RNDU);
+    }
+
+  public:
+    HalfPi(const HalfPi&) = delete;
+    HalfPi& operator=(const HalfPi&) = delete;
+
+    ~HalfPi() {
+        mpfr_clear(half_pi_d);
+        mpfr_clear(half_pi_u);
+    }
+
+    mpfr_srcptr lower() const {
+        return half_pi_d;
+    }
+
+    mpfr_srcptr upper() const {
+        return half_pi_u;
+    }
+
+    static const HalfPi& get(const uint32_t prec) {
+
+        static std::mutex mutex{};
+        static std::map<uint32_t, std::unique_ptr<const HalfPi>> cache{};
+
+        const std::lock_guard<std::mutex> lock{mutex};
+
+        auto& half_pi = cache[prec];
+
+        if (!half_pi) {
+            half_pi.reset(new HalfPi{prec});
+        }
+
+        return *half_pi;
+    }
+};
+
+Evaluator::Evaluator(const uint32_t prec, const TrigMode mode_)
+    : precision{prec},
+      start_precision{std::min<uint32_t>(64, prec)},
+      mode{mode_},
+      x_double{0, 0},
+      y_double{0, 0},
+      kernel_valid{false},
+      half_pi_d{HalfPi::get(prec).lower()},
+      half_pi_u{HalfPi::get(prec).upper()} {
 
     mpz_init(quot);
     mpz_init(rem);
@@ -176,16 +619,6 @@ Evaluator::Evaluator(const uint32_t prec) {
 
     mpfr_init2(term, prec);
     mpfr_init2(sum, prec);
-
-    // These are important constants, so they have twice the precision
-    mpfr_init2(half_pi_d, 2 * prec);
-    mpfr_init2(half_pi_u, 2 * prec);
-
-    mpfr_const_pi(half_pi_d, MPFR_RNDD);
-    mpfr_const_pi(half_pi_u, MPFR_RNDU);
-
-    mpfr_div_ui(half_pi_d, half_pi_d, 2, MPFR_RNDD);
-    mpfr_div_ui(half_pi_u, half_pi_u, 2, MPFR_RNDU);
 }
 
 Evaluator::~Evaluator() {
@@ -199,402 +632,1001 @@ Evaluator::~Evaluator() {
     mpfr_clear(term);
     mpfr_clear(sum);
 
-    mpfr_clear(half_pi_d);
-    mpfr_clear(half_pi_u);
+    for (auto& b : bounds) {
+        mpfr_clear(b.sin_d);
+        mpfr_clear(b.sin_u);
+        mpfr_clear(b.cos_d);
+        mpfr_clear(b.cos_u);
+    }
 }
 
-template <template <typename> class Trig>
-bool Evaluator::is_positive(const EqVec<Trig>& eq, const Coeff64 bx, const Coeff64 by,
-                            const PointQ& center, const Rational& rx, const Rational& ry) {
+void Evaluator::set_start_precision(const uint32_t prec) {
+    start_precision = std::max<uint32_t>(std::min(prec, precision), MPFR_PREC_MIN);
+}
 
-    mpfr_clear_flags();
+const std::map<uint32_t, uint64_t>& Evaluator::precision_histogram() const {
+    return histogram;
+}
 
-    mpfr_set_zero(sum, 0);
+void Evaluator::clear_precision_histogram() {
+    histogram.clear();
+}
 
-    for (const auto& kv : eq) {
+Evaluator& thread_evaluator(const uint32_t prec) {
 
-        // t_coeff * trig(x_coeff * center.x * pi/2 + y_coeff * center.y * pi/2)
+    static thread_local std::map<uint32_t, std::unique_ptr<Evaluator>> evaluators{};
 
-        const auto x_coeff = kv.first.arg.coeff(XY::X);
-        const auto y_coeff = kv.first.arg.coeff(XY::Y);
-        const auto t_coeff = kv.second;
+    auto& eval = evaluators[prec];
 
-        mpq_set_si(xq, x_coeff, 1);
-        mpq_set_si(yq, y_coeff, 1);
+    if (!eval) {
+        eval.reset(new Evaluator{prec});
+    }
 
-        mpq_mul(xq, xq, center.x.backend().data());
-        mpq_mul(yq, yq, center.y.backend().data());
+    return *eval;
+}
 
-        mpq_add(argq, xq, yq);
+uint32_t Evaluator::next_precision(const uint32_t prec) const {
+    return std::min(2 * prec, precision);
+}
 
-        mpz_fdiv_qr(quot, rem, mpq_numref(argq), mpq_denref(argq));
+// Every MPFR value is allocated with the maximum precision, so we can use mpfr_set_prec_raw
+// to change the precision without reallocating. This invalidates their values.
+void Evaluator::set_working_precision(const uint32_t prec) {
 
-        // Reuse xq, yq, argq
+    mpfr_set_prec_raw(term, prec);
+    mpfr_set_prec_raw(sum, prec);
+
+    for (auto& b : bounds) {
+        mpfr_set_prec_raw(b.sin_d, prec);
+        mpfr_set_prec_raw(b.sin_u, prec);
+        mpfr_set_prec_raw(b.cos_d, prec);
+        mpfr_set_prec_raw(b.cos_u, prec);
+    }
+}
 
-        mpq_set_z(xq, rem);
-        mpq_set_z(yq, mpq_denref(argq));
+// Reduce the argument x_coeff * center.x + y_coeff * center.y (in units of pi/2) to its
+// fractional part, which is left in argq, and return the quadrant it lies in.
+unsigned long Evaluator::reduce(const Coeff64 x_coeff, const Coeff64 y_coeff, const PointQ& center) {
 
-        // This is the remainder fraction. 0 <= argq < 1
-        mpq_div(argq, xq, yq);
+    const auto x_den = mpq_denref(center.x.backend().data());
+    const auto y_den = mpq_denref(center.y.backend().data());
 
-        // The return value of this function is the remainder
-        const auto quad = mpz_fdiv_ui(quot, 4);
+    if (mpz_popcount(x_den) == 1 && mpz_popcount(y_den) == 1) {
+        return reduce_dyadic(x_coeff, y_coeff, center);
+    }
 
-        // We can ignore the quotient part of the above remainder, since
-        // sin(x + 2pi) = sin(x)
-        // cos(x + 2pi) = cos(x)
+    return reduce_rational(x_coeff, y_coeff, center);
+}
 
-        eval_trig<Trig>(term, t_coeff, argq, quad, half_pi_d, half_pi_u);
+// The general version of reduce, which works for any rational center
+unsigned long Evaluator::reduce_rational(const Coeff64 x_coeff, const Coeff64 y_coeff, const PointQ& center) {
 
-        mpfr_add(sum, sum, term, MPFR_RNDD);
-    }
+    mpq_set_si(xq, x_coeff, 1); // xq = x_coeff
+    mpq_set_si(yq, y_coeff, 1); // yq = y_coeff
+
+    mpq_mul(xq, xq, center.x.backend().data()); // xq = xq * center.x
+    mpq_mul(yq, yq, center.y.backend().data()); // yq = yq * center.y
+
+    mpq_add(argq, xq, yq); // argq = xq + yq
+
+    mpz_fdiv_qr(quot, rem, mpq_numref(argq), mpq_denref(argq)); // perform integer division with remainder
 
     // Reuse xq, yq, argq
-    mpq_set_si(xq, bx, 1);
-    mpq_set_si(yq, by, 1);
 
-    mpq_mul(xq, xq, rx.backend().data());
-    mpq_mul(yq, yq, ry.backend().data());
+    mpq_set_z(xq, rem);
+    mpq_set_z(yq, mpq_denref(argq));
 
-    mpq_add(argq, xq, yq);
+    // This is the remainder fraction. 0 <= argq < 1
+    mpq_div(argq, xq, yq);
 
-    // Reuse term
-    mpfr_mul_q(term, half_pi_u, argq, MPFR_RNDU);
+    // We can ignore the quotient part of the above remainder, since
+    // sin(x + 2pi) = sin(x)
+    // cos(x + 2pi) = cos(x)
 
-    const bool is_pos = mpfr_greater_p(sum, term);
+    // The return value of this function is the remainder
+    return mpz_fdiv_ui(quot, 4);
+}
 
-    // Now we check for errors.
-    // We don't check the INEXACT flag, because that one will be set when evaluating the trig functions
-#if 0
-    const auto mask = MPFR_FLAGS_UNDERFLOW | MPFR_FLAGS_OVERFLOW | MPFR_FLAGS_NAN | MPFR_FLAGS_ERANGE;
+// The same as reduce, but for a center whose coordinates both have power of two denominators,
+// which is the case for every square in a cover. Then the argument is n / 2^e for an integer n,
+// so we can find the quadrant and fractional part with shifts and masks, instead of general
+// rational arithmetic (which has to find a GCD at every step).
+unsigned long Evaluator::reduce_dyadic(const Coeff64 x_coeff, const Coeff64 y_coeff, const PointQ& center) {
 
-    const auto flags = mpfr_flags_test(mask);
+    const auto x = center.x.backend().data();
+    const auto y = center.y.backend().data();
 
-    if (flags != 0) {
+    const auto x_exp = mpz_scan1(mpq_denref(x), 0);
+    const auto y_exp = mpz_scan1(mpq_denref(y), 0);
 
-        std::ostringstream oss{};
-        oss << "error: flags raised in calculation of " << eq
-            << " at point " << center
-            << " with radius " << radius << '\n';
+    const auto exp = std::max(x_exp, y_exp);
 
-        if (flags & MPFR_FLAGS_UNDERFLOW) {
-            oss << "underflow\n";
-        }
+    // quot = x_coeff * x * 2^exp + y_coeff * y * 2^exp, which is an integer
+    mpz_mul_si(quot, mpq_numref(x), x_coeff);
+    mpz_mul_2exp(quot, quot, exp - x_exp);
 
-        if (flags & MPFR_FLAGS_OVERFLOW) {
-            oss << "overflow\n";
-        }
+    mpz_mul_si(rem, mpq_numref(y), y_coeff);
+    mpz_mul_2exp(rem, rem, exp - y_exp);
 
-        //if (flags & MPFR_FLAGS_DIVBY0) {
-            //oss << "divby0\n";
-        //}
+    mpz_add(quot, quot, rem);
 
-        if (flags & MPFR_FLAGS_NAN) {
-            oss << "nan\n";
-        }
+    // floor(quot / 2^exp) mod 4 is given by the two bits above the binary point.
+    // mpz_tstbit uses two's complement for negative numbers, so this is correct for them too.
+    const auto quad = static_cast<unsigned long>(mpz_tstbit(quot, exp)) |
+                      (static_cast<unsigned long>(mpz_tstbit(quot, exp + 1)) << 1);
 
-        if (flags & MPFR_FLAGS_ERANGE) {
-            oss << "erange\n";
-        }
+    // The bits below the binary point are the fractional part. 0 <= argq < 1
+    mpz_fdiv_r_2exp(rem, quot, exp);
 
-        throw std::runtime_error(oss.str());
+    mpq_set_z(argq, rem);
+    mpq_div_2exp(argq, argq, exp);
+
+    return quad;
+}
+
+template <template <typename> class Trig>
+bool Evaluator::is_positive(const EquationView<Trig>& eq,
+                            const PointQ& center, const Rational& rx, const Rational& ry) {
+
+    const auto bx = eq.bx();
+    const auto by = eq.by();
+
+    if (set_double_center(center) && double_is_positive<Trig>(eq, bx, by, rx, ry)) {
+        ++histogram[0];
+        return true;
     }
-#endif
 
-    const bool err = mpfr_underflow_p() || mpfr_overflow_p() || mpfr_nanflag_p() || mpfr_erangeflag_p();
+    // Start at a low precision, and only escalate if the result is inconclusive
+    for (auto prec = start_precision;; prec = next_precision(prec)) {
 
-    if (err) {
+        set_working_precision(prec);
 
-        std::ostringstream oss{};
-        oss << "error: flags raised in calculation of " << eq
-            << " at point " << center
-            << " with radius " << rx << " " << ry << '\n';
+        mpfr_clear_flags();
+
+        mpfr_set_zero(sum, 0);
+
+        for (const auto& kv : eq) {
+
+            // t_coeff * trig(x_coeff * center.x * pi/2 + y_coeff * center.y * pi/2)
 
-        if (mpfr_underflow_p()) {
-            oss << "underflow\n";
+            const auto x_coeff = term_x(kv);
+            const auto y_coeff = term_y(kv);
+            const auto t_coeff = term_t(kv);
+
+            // argq = fractional part of the argument
+            const auto quad = reduce(x_coeff, y_coeff, center);
+
+            eval_trig<Trig>(term, t_coeff, argq, quad, half_pi_d, half_pi_u);
+
+            mpfr_add(sum, sum, term, MPFR_RNDD);
         }
 
-        if (mpfr_overflow_p()) {
-            oss << "overflow\n";
+        // Reuse xq, yq, argq
+        mpq_set_si(xq, bx, 1);
+        mpq_set_si(yq, by, 1);
+
+        mpq_mul(xq, xq, rx.backend().data());
+        mpq_mul(yq, yq, ry.backend().data());
+
+        mpq_add(argq, xq, yq);
+
+        // Reuse term
+        mul_frac(term, half_pi_u, argq, MPFR_RNDU);
+
+        const bool is_pos = mpfr_greater_p(sum, term);
+
+        // Now we check for errors.
+        // We don't check the INEXACT flag, because that one will be set when evaluating the trig functions
+#if 0
+        const auto mask = MPFR_FLAGS_UNDERFLOW | MPFR_FLAGS_OVERFLOW | MPFR_FLAGS_NAN | MPFR_FLAGS_ERANGE;
+
+        const auto flags = mpfr_flags_test(mask);
+
+        if (flags != 0) {
+
+            std::ostringstream oss{};
+            oss << "error: flags raised in calculation of " << eq
+                << " at point " << center
+                << " with radius " << radius << '\n';
+
+            if (flags & MPFR_FLAGS_UNDERFLOW) {
+                oss << "underflow\n";
+            }
+
+            if (flags & MPFR_FLAGS_OVERFLOW) {
+                oss << "overflow\n";
+            }
+
+            //if (flags & MPFR_FLAGS_DIVBY0) {
+                //oss << "divby0\n";
+            //}
+
+            if (flags & MPFR_FLAGS_NAN) {
+                oss << "nan\n";
+            }
+
+            if (flags & MPFR_FLAGS_ERANGE) {
+                oss << "erange\n";
+            }
+
+            throw std::runtime_error(oss.str());
         }
+#endif
+
+        const bool err = mpfr_underflow_p() || mpfr_overflow_p() || mpfr_nanflag_p() || mpfr_erangeflag_p();
 
-        if (mpfr_nanflag_p()) {
-            oss << "nan\n";
+        if (err) {
+
+            std::ostringstream oss{};
+            oss << "error: flags raised in calculation of " << eq
+                << " at point " << center
+                << " with radius " << rx << " " << ry << '\n';
+
+            if (mpfr_underflow_p()) {
+                oss << "underflow\n";
+            }
+
+            if (mpfr_overflow_p()) {
+                oss << "overflow\n";
+            }
+
+            if (mpfr_nanflag_p()) {
+                oss << "nan\n";
+            }
+
+            if (mpfr_erangeflag_p()) {
+                oss << "erange\n";
+            }
+
+            throw std::runtime_error(oss.str());
         }
 
-        if (mpfr_erangeflag_p()) {
-            oss << "erange\n";
+        if (is_pos) {
+            ++histogram[prec];
+            return true;
         }
 
-        throw std::runtime_error(oss.str());
+        if (prec == precision) {
+            return false;
+        }
     }
-
-    return is_pos;
 }
 
-template bool Evaluator::is_positive(const EqVec<Sin>& eq, const Coeff64 bx, const Coeff64 by,
+template bool Evaluator::is_positive(const EquationView<Sin>& eq,
                                      const PointQ& center, const Rational& rx, const Rational& ry);
-template bool Evaluator::is_positive(const EqVec<Cos>& eq, const Coeff64 bx, const Coeff64 by,
+template bool Evaluator::is_positive(const EquationView<Cos>& eq,
                                      const PointQ& center, const Rational& rx, const Rational& ry);
 
 template <template <typename> class Trig>
 bool Evaluator::is_positive(const EqMap<Trig>& eq, const Coeff64 bx, const Coeff64 by,
                             const PointQ& center, const Rational& rx, const Rational& ry) {
 
-    mpfr_clear_flags();
+    if (set_double_center(center) && double_is_positive<Trig>(eq, bx, by, rx, ry)) {
+        ++histogram[0];
+        return true;
+    }
 
-    mpfr_set_zero(sum, 0);
+    // Start at a low precision, and only escalate if the result is inconclusive
+    for (auto prec = start_precision;; prec = next_precision(prec)) {
 
-    for (const auto& kv : eq) {
+        set_working_precision(prec);
 
-        // t_coeff * trig(x_coeff * center.x * pi/2 + y_coeff * center.y * pi/2)
+        mpfr_clear_flags();
 
-        const auto x_coeff = kv.first.arg.coeff(XY::X);
-        const auto y_coeff = kv.first.arg.coeff(XY::Y);
-        const auto t_coeff = kv.second;
+        mpfr_set_zero(sum, 0);
 
-        mpq_set_si(xq, x_coeff, 1);
-        mpq_set_si(yq, y_coeff, 1);
+        for (const auto& kv : eq) {
 
-        mpq_mul(xq, xq, center.x.backend().data());
-        mpq_mul(yq, yq, center.y.backend().data());
+            // t_coeff * trig(x_coeff * center.x * pi/2 + y_coeff * center.y * pi/2)
 
-        mpq_add(argq, xq, yq);
+            const auto x_coeff = term_x(kv);
+            const auto y_coeff = term_y(kv);
+            const auto t_coeff = term_t(kv);
 
-        mpz_fdiv_qr(quot, rem, mpq_numref(argq), mpq_denref(argq));
+            // argq = fractional part of the argument
+            const auto quad = reduce(x_coeff, y_coeff, center);
 
-        // Reuse xq, yq, argq
+            eval_trig<Trig>(term, t_coeff, argq, quad, half_pi_d, half_pi_u);
 
-        mpq_set_z(xq, rem);
-        mpq_set_z(yq, mpq_denref(argq));
+            mpfr_add(sum, sum, term, MPFR_RNDD);
+        }
 
-        // This is the remainder fraction. 0 <= argq < 1
-        mpq_div(argq, xq, yq);
+        // Reuse xq, yq, argq
+        mpq_set_si(xq, bx, 1);
+        mpq_set_si(yq, by, 1);
 
-        // The return value of this function is the remainder
-        const auto quad = mpz_fdiv_ui(quot, 4);
+        mpq_mul(xq, xq, rx.backend().data());
+        mpq_mul(yq, yq, ry.backend().data());
 
-        // We can ignore the quotient part of the above remainder, since
-        // sin(x + 2pi) = sin(x)
-        // cos(x + 2pi) = cos(x)
+        mpq_add(argq, xq, yq);
 
-        eval_trig<Trig>(term, t_coeff, argq, quad, half_pi_d, half_pi_u);
+        // Reuse term
+        mul_frac(term, half_pi_u, argq, MPFR_RNDU);
 
-        mpfr_add(sum, sum, term, MPFR_RNDD);
-    }
+        const bool is_pos = mpfr_greater_p(sum, term);
 
-    // Reuse xq, yq, argq
-    mpq_set_si(xq, bx, 1);
-    mpq_set_si(yq, by, 1);
+        // Now we check for errors.
+        // We don't check the INEXACT flag, because that one will be set when evaluating the trig functions
+#if 0
+        const auto mask = MPFR_FLAGS_UNDERFLOW | MPFR_FLAGS_OVERFLOW | MPFR_FLAGS_NAN | MPFR_FLAGS_ERANGE;
 
-    mpq_mul(xq, xq, rx.backend().data());
-    mpq_mul(yq, yq, ry.backend().data());
+        const auto flags = mpfr_flags_test(mask);
 
-    mpq_add(argq, xq, yq);
+        if (flags != 0) {
 
-    // Reuse term
-    mpfr_mul_q(term, half_pi_u, argq, MPFR_RNDU);
+            std::ostringstream oss{};
+            oss << "error: flags raised in calculation of " << eq
+                << " at point " << center
+                << " with radius " << radius << '\n';
 
-    const bool is_pos = mpfr_greater_p(sum, term);
+            if (flags & MPFR_FLAGS_UNDERFLOW) {
+                oss << "underflow\n";
+            }
 
-    // Now we check for errors.
-    // We don't check the INEXACT flag, because that one will be set when evaluating the trig functions
-#if 0
-    const auto mask = MPFR_FLAGS_UNDERFLOW | MPFR_FLAGS_OVERFLOW | MPFR_FLAGS_NAN | MPFR_FLAGS_ERANGE;
+            if (flags & MPFR_FLAGS_OVERFLOW) {
+                oss << "overflow\n";
+            }
 
-    const auto flags = mpfr_flags_test(mask);
+            //if (flags & MPFR_FLAGS_DIVBY0) {
+                //oss << "divby0\n";
+            //}
 
-    if (flags != 0) {
+            if (flags & MPFR_FLAGS_NAN) {
+                oss << "nan\n";
+            }
 
-        std::ostringstream oss{};
-        oss << "error: flags raised in calculation of " << eq
-            << " at point " << center
-            << " with radius " << radius << '\n';
+            if (flags & MPFR_FLAGS_ERANGE) {
+                oss << "erange\n";
+            }
 
-        if (flags & MPFR_FLAGS_UNDERFLOW) {
-            oss << "underflow\n";
+            throw std::runtime_error(oss.str());
         }
+#endif
 
-        if (flags & MPFR_FLAGS_OVERFLOW) {
-            oss << "overflow\n";
-        }
+        const bool err = mpfr_underflow_p() || mpfr_overflow_p() || mpfr_nanflag_p() || mpfr_erangeflag_p();
+
+        if (err) {
+
+            std::ostringstream oss{};
+            oss << "error: flags raised in calculation of " << eq
+                << " at point " << center
+                << " with radius " << rx << " " << ry << '\n';
+
+            if (mpfr_underflow_p()) {
+                oss << "underflow\n";
+            }
 
-        //if (flags & MPFR_FLAGS_DIVBY0) {
-            //oss << "divby0\n";
-        //}
+            if (mpfr_overflow_p()) {
+                oss << "overflow\n";
+            }
 
-        if (flags & MPFR_FLAGS_NAN) {
-            oss << "nan\n";
+            if (mpfr_nanflag_p()) {
+                oss << "nan\n";
+            }
+
+            if (mpfr_erangeflag_p()) {
+                oss << "erange\n";
+            }
+
+            throw std::runtime_error(oss.str());
         }
 
-        if (flags & MPFR_FLAGS_ERANGE) {
-            oss << "erange\n";
+        if (is_pos) {
+            ++histogram[prec];
+            return true;
         }
 
+        if (prec == precision) {
+            return false;
+        }
+    }
+}
+
+template bool Evaluator::is_positive(const EqMap<Sin>& eq, const Coeff64 bx, const Coeff64 by,
+                                     const PointQ& center, const Rational& rx, const Rational& ry);
+template bool Evaluator::is_positive(const EqMap<Cos>& eq, const Coeff64 bx, const Coeff64 by,
+                                     const PointQ& center, const Rational& rx, const Rational& ry);
+
+// The terms that use each distinct argument. Which bounds we actually need depends on
+// the quadrant, which we only know after reducing the argument.
+enum Use : uint8_t {
+    SinPos = 1 << 0,
+    SinNeg = 1 << 1,
+    CosPos = 1 << 2,
+    CosNeg = 1 << 3,
+};
+
+template <template <typename> class Trig>
+uint8_t term_use(const Coeff64 coeff);
+
+template <>
+uint8_t term_use<Sin>(const Coeff64 coeff) {
+    return coeff > 0 ? Use::SinPos : Use::SinNeg;
+}
+
+template <>
+uint8_t term_use<Cos>(const Coeff64 coeff) {
+    return coeff > 0 ? Use::CosPos : Use::CosNeg;
+}
+
+// This mirrors eval_trig: which of eval_trig_helper<Sin> (true) or eval_trig_helper<Cos> (false)
+// ends up being called for the given quadrant, and with what coefficient.
+template <template <typename> class Trig>
+std::pair<bool, Coeff64> unfold_quadrant(const unsigned long quad, const Coeff64 coeff);
+
+template <>
+std::pair<bool, Coeff64> unfold_quadrant<Sin>(const unsigned long quad, const Coeff64 coeff) {
+
+    if (coeff == 0) {
+        throw std::runtime_error("unfold_quadrant<Sin>: zero coeff");
+    }
+
+    if (quad == 0) {
+        return {true, coeff};
+    } else if (quad == 1) {
+        return {false, coeff};
+    } else if (quad == 2) {
+        return {true, -coeff};
+    } else if (quad == 3) {
+        return {false, -coeff};
+    } else {
+        std::ostringstream oss{};
+        oss << "unfold_quadrant<Sin>: unknown quadrant " << quad;
         throw std::runtime_error(oss.str());
     }
-#endif
+}
 
-    const bool err = mpfr_underflow_p() || mpfr_overflow_p() || mpfr_nanflag_p() || mpfr_erangeflag_p();
+template <>
+std::pair<bool, Coeff64> unfold_quadrant<Cos>(const unsigned long quad, const Coeff64 coeff) {
 
-    if (err) {
+    if (coeff == 0) {
+        throw std::runtime_error("unfold_quadrant<Cos>: zero coeff");
+    }
 
+    if (quad == 0) {
+        return {false, coeff};
+    } else if (quad == 1) {
+        return {true, -coeff};
+    } else if (quad == 2) {
+        return {false, -coeff};
+    } else if (quad == 3) {
+        return {true, coeff};
+    } else {
         std::ostringstream oss{};
-        oss << "error: flags raised in calculation of " << eq
-            << " at point " << center
-            << " with radius " << rx << " " << ry << '\n';
+        oss << "unfold_quadrant<Cos>: unknown quadrant " << quad;
+        throw std::runtime_error(oss.str());
+    }
+}
 
-        if (mpfr_underflow_p()) {
-            oss << "underflow\n";
+// The bound that eval_trig_helper would have calculated
+static const __mpfr_struct* select_bound(const TrigBounds& b, const std::pair<bool, Coeff64>& helper) {
+
+    if (helper.first) {
+        // sin is rounded down for positive coeffs, and up for negative ones
+        return helper.second > 0 ? b.sin_d : b.sin_u;
+    } else {
+        // Same for cos
+        return helper.second > 0 ? b.cos_d : b.cos_u;
+    }
+}
+
+template <template <typename> class Trig>
+void Evaluator::add_uses(const EquationView<Trig>& eq) {
+
+    for (const auto packed : eq) {
+
+        const std::pair<Coeff64, Coeff64> arg{packed.x, packed.y};
+
+        const auto it = std::lower_bound(std::cbegin(args), std::cend(args), arg);
+        const auto index = static_cast<size_t>(it - std::cbegin(args));
+
+        uses.at(index) |= term_use<Trig>(packed.t);
+    }
+}
+
+// Calculate the bounds needed by the argument at index, whose fractional part is in argq
+void Evaluator::calculate_bounds(const size_t index) {
+
+    auto& b = bounds.at(index);
+    const auto quad = quads.at(index);
+    const auto use = uses.at(index);
+
+    bool need_sin_d = false;
+    bool need_sin_u = false;
+    bool need_cos_d = false;
+    bool need_cos_u = false;
+
+    const auto need = [&](const std::pair<bool, Coeff64>& helper) {
+        if (helper.first) {
+            (helper.second > 0 ? need_sin_d : need_sin_u) = true;
+        } else {
+            (helper.second > 0 ? need_cos_d : need_cos_u) = true;
         }
+    };
+
+    if (use & Use::SinPos) {
+        need(unfold_quadrant<Sin>(quad, 1));
+    }
 
-        if (mpfr_overflow_p()) {
-            oss << "overflow\n";
+    if (use & Use::SinNeg) {
+        need(unfold_quadrant<Sin>(quad, -1));
+    }
+
+    if (use & Use::CosPos) {
+        need(unfold_quadrant<Cos>(quad, 1));
+    }
+
+    if (use & Use::CosNeg) {
+        need(unfold_quadrant<Cos>(quad, -1));
+    }
+
+    // Both sin rounded down and cos rounded up use the argument rounded down.
+    // See eval_trig_helper for why these are correct.
+    if (need_sin_d || need_cos_u) {
+
+        mul_frac(term, half_pi_d, argq, MPFR_RNDD);
+
+        if (need_sin_d && need_cos_u) {
+
+            const auto inex = mpfr_sin_cos(b.sin_d, b.cos_u, term, MPFR_RNDD);
+
+            // mpfr_sin_cos rounds both results in the same direction, so the cos has been
+            // rounded down instead of up. The return value is s + 4c, where c is 0 iff the cos
+            // is exact. Since the result is correctly rounded, if it is inexact, the next float
+            // up is exactly what rounding up would have given.
+            if ((inex >> 2) != 0) {
+                mpfr_nextabove(b.cos_u);
+            }
+
+        } else if (need_sin_d) {
+            mpfr_sin(b.sin_d, term, MPFR_RNDD);
+        } else {
+            mpfr_cos(b.cos_u, term, MPFR_RNDU);
+        }
+    }
+
+    // And both sin rounded up and cos rounded down use the argument rounded up
+    if (need_sin_u || need_cos_d) {
+
+        mul_frac(term, half_pi_u, argq, MPFR_RNDU);
+
+        if (mpfr_greater_p(term, half_pi_d)) {
+            // sin(pi/2) = 1 and cos(pi/2) = 0
+            mpfr_set_ui(b.sin_u, 1, MPFR_RNDU);
+            mpfr_set_zero(b.cos_d, 0);
+
+        } else if (need_sin_u && need_cos_d) {
+
+            const auto inex = mpfr_sin_cos(b.sin_u, b.cos_d, term, MPFR_RNDU);
+
+            // Same as above, but the other way around
+            if ((inex >> 2) != 0) {
+                mpfr_nextbelow(b.cos_d);
+            }
+
+        } else if (need_sin_u) {
+            mpfr_sin(b.sin_u, term, MPFR_RNDU);
+        } else {
+            mpfr_cos(b.cos_d, term, MPFR_RNDD);
         }
+    }
+}
+
+// Sum the terms of the equation into sum, in exactly the same way as is_positive does
+template <template <typename> class Trig>
+void Evaluator::sum_terms(const EquationView<Trig>& eq) {
+
+    mpfr_set_zero(sum, 0);
+
+    for (const auto packed : eq) {
 
-        if (mpfr_nanflag_p()) {
-            oss << "nan\n";
+        const std::pair<Coeff64, Coeff64> arg{packed.x, packed.y};
+
+        const auto it = std::lower_bound(std::cbegin(args), std::cend(args), arg);
+        const auto index = static_cast<size_t>(it - std::cbegin(args));
+
+        const auto helper = unfold_quadrant<Trig>(quads.at(index), packed.t);
+
+        mpfr_mul_si(term, select_bound(bounds.at(index), helper), helper.second, MPFR_RNDD);
+
+        mpfr_add(sum, sum, term, MPFR_RNDD);
+    }
+}
+
+// Reduce each distinct argument of the pending equations, and calculate the bounds they need
+// at the given precision
+void Evaluator::calculate_shared_bounds(const PointQ& center, const uint32_t prec) {
+
+    args.clear();
+
+    for (const auto& eq : pending_sines) {
+        for (const auto packed : eq) {
+            args.emplace_back(packed.x, packed.y);
         }
+    }
 
-        if (mpfr_erangeflag_p()) {
-            oss << "erange\n";
+    for (const auto& eq : pending_cosines) {
+        for (const auto packed : eq) {
+            args.emplace_back(packed.x, packed.y);
         }
+    }
 
-        throw std::runtime_error(oss.str());
+    std::sort(std::begin(args), std::end(args));
+    args.erase(std::unique(std::begin(args), std::end(args)), std::end(args));
+
+    uses.assign(args.size(), 0);
+
+    for (const auto& eq : pending_sines) {
+        add_uses(eq);
     }
 
-    return is_pos;
-}
+    for (const auto& eq : pending_cosines) {
+        add_uses(eq);
+    }
 
-template bool Evaluator::is_positive(const EqMap<Sin>& eq, const Coeff64 bx, const Coeff64 by,
-                                     const PointQ& center, const Rational& rx, const Rational& ry);
-template bool Evaluator::is_positive(const EqMap<Cos>& eq, const Coeff64 bx, const Coeff64 by,
-                                     const PointQ& center, const Rational& rx, const Rational& ry);
+    quads.resize(args.size());
+
+    while (bounds.size() < args.size()) {
+        bounds.emplace_back();
+
+        // These are allocated at the maximum precision, so set_working_precision can
+        // lower it without reallocating
+        auto& b = bounds.back();
+        mpfr_init2(b.sin_d, precision);
+        mpfr_init2(b.sin_u, precision);
+        mpfr_init2(b.cos_d, precision);
+        mpfr_init2(b.cos_u, precision);
+    }
 
+    set_working_precision(prec);
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        // argq = fractional part of the argument
+        quads.at(i) = reduce(args.at(i).first, args.at(i).second, center);
+        calculate_bounds(i);
+    }
+}
+
+// The directional version of double_is_positive, for the segment from center - (dx, dy) to
+// center + (dx, dy). Writing g(s) = f(center + s * (dx, dy)) for s in [-1, 1], each term of g'
+// is -t * trig'(arg) * (a * dx + b * dy) * pi/2, so
+//
+//     |g(s) - g(0)| <= sum of |t| * |a * dx + b * dy| * pi/2
+//
+// which is never larger than the bound (bx * |dx| + by * |dy|) * pi/2 over the whole box, and
+// is much smaller when the segment runs close to the level curves of the terms. The second
+// order test is the same as before, but with g''(s) bounded by the sum of |t| * (a * dx + b * dy)^2.
 template <template <typename> class Trig>
-bool Evaluator::is_positive(const EqVec<Trig>& eq, const Coeff64 bound, const PointQ& center, const Rational& radius) {
+bool Evaluator::double_is_positive_along(const EquationView<Trig>& eq, const Rational& dx, const Rational& dy) {
 
-    mpfr_clear_flags();
+    const auto dx_double = to_interval(dx);
+    const auto dy_double = to_interval(dy);
 
-    mpfr_set_zero(sum, 0);
+    if (!dx_double.is_finite() || !dy_double.is_finite()) {
+        return false;
+    }
 
-    for (const auto& kv : eq) {
+    const math::DoubleInterval zero{0, 0};
 
-        // t_coeff * trig(x_coeff * center.x * pi/2 + y_coeff * center.y * pi/2)
+    auto lipschitz = zero;
+    auto curvature = zero;
 
-        const auto x_coeff = kv.first.arg.coeff(XY::X);
-        const auto y_coeff = kv.first.arg.coeff(XY::Y);
-        const auto t_coeff = kv.second;
+    for (const auto packed : eq) {
 
-        mpq_set_si(xq, x_coeff, 1); // xq = x_coeff
-        mpq_set_si(yq, y_coeff, 1); // yq = y_coeff
+        // |a * dx + b * dy|
+        const auto dir = magnitude(packed.x * dx_double + packed.y * dy_double);
 
-        mpq_mul(xq, xq, center.x.backend().data()); // xq = xq * center.x
-        mpq_mul(yq, yq, center.y.backend().data()); // yq = yq * center.y
+        lipschitz = lipschitz + math::abs(packed.t) * dir;
+        curvature = curvature + math::abs(packed.t) * (dir * dir);
+    }
 
-        mpq_add(argq, xq, yq); // argq = xq + yq
+    const auto half_pi = math::half_pi_interval();
 
-        mpz_fdiv_qr(quot, rem, mpq_numref(argq), mpq_denref(argq)); // perform integer division with remainder
+    // We only use the value and gradient, so the radii only affect the curvature we ignore
+    const auto taylor = double_taylor<Trig>(eq, magnitude(dx_double), magnitude(dy_double));
 
-        // Reuse xq, yq, argq
+    const auto bound = lipschitz * half_pi;
 
-        mpq_set_z(xq, rem);
-        mpq_set_z(yq, mpq_denref(argq));
+    if (bound.is_finite() && taylor.value.lower() > bound.upper()) {
+        return true;
+    }
 
-        // This is the remainder fraction. 0 <= argq < 1
-        mpq_div(argq, xq, yq);
+    // The gradient already has its factor of pi/2
+    const auto linear = magnitude(taylor.dx * dx_double + taylor.dy * dy_double);
+    const auto quadratic = math::DoubleInterval{0.5, 0.5} * (curvature * half_pi * half_pi);
 
-        // The return value of this function is the remainder
-        const auto quad = mpz_fdiv_ui(quot, 4);
+    const auto lower = taylor.value - linear - quadratic;
 
-        // We can ignore the quotient part of the above remainder, since
-        // sin(x + 2pi) = sin(x)
-        // cos(x + 2pi) = cos(x)
+    return lower.is_finite() && lower.lower() > 0;
+}
 
-        eval_trig<Trig>(term, t_coeff, argq, quad, half_pi_d, half_pi_u);
+template <template <typename> class Trig>
+bool Evaluator::double_is_positive(const EquationView<Trig>& eq, const Extent& extent) {
 
-        mpfr_add(sum, sum, term, MPFR_RNDD);
+    if (extent.segment) {
+        return double_is_positive_along(eq, extent.x, extent.y);
+    } else {
+        return double_is_positive<Trig>(eq, eq.bx(), eq.by(), extent.x, extent.y);
     }
+}
 
-    // Reuse argq
-    mpq_set_si(argq, bound, 1);
-    mpq_mul(argq, argq, radius.backend().data());
+// The bound on how far the equation can move away from its value at the center, times pi/2
+// and rounded up, into term. See double_is_positive_along for the segment bound.
+template <template <typename> class Trig>
+void Evaluator::bound_term(const EquationView<Trig>& eq, const Extent& extent) {
 
-    // Reuse term
-    mpfr_mul_q(term, half_pi_u, argq, MPFR_RNDU);
+    if (extent.segment) {
 
-    const bool is_pos = mpfr_greater_p(sum, term);
+        mpq_set_ui(argq, 0, 1);
 
-    // Now we check for errors.
-    // We don't check the INEXACT flag, because that one will be set when evaluating the trig functions
-#if 0
-    const auto mask = MPFR_FLAGS_UNDERFLOW | MPFR_FLAGS_OVERFLOW | MPFR_FLAGS_NAN | MPFR_FLAGS_ERANGE;
+        for (const auto packed : eq) {
 
-    const auto flags = mpfr_flags_test(mask);
+            // xq = |a * dx + b * dy|
+            mpq_set_si(xq, packed.x, 1);
+            mpq_set_si(yq, packed.y, 1);
 
-    if (flags != 0) {
+            mpq_mul(xq, xq, extent.x.backend().data());
+            mpq_mul(yq, yq, extent.y.backend().data());
 
-        std::ostringstream oss{};
-        oss << "error: flags raised in calculation of " << eq
-            << " at point " << center
-            << " with radius " << radius << '\n';
+            mpq_add(xq, xq, yq);
+            mpq_abs(xq, xq);
+
+            // argq += |t| * xq
+            mpq_set_si(yq, math::abs(packed.t), 1);
+            mpq_mul(xq, xq, yq);
+
+            mpq_add(argq, argq, xq);
+        }
+
+    } else {
+
+        // bx * rx + by * ry
+        mpq_set_si(xq, eq.bx(), 1);
+        mpq_set_si(yq, eq.by(), 1);
+
+        mpq_mul(xq, xq, extent.x.backend().data());
+        mpq_mul(yq, yq, extent.y.backend().data());
+
+        mpq_add(argq, xq, yq);
+    }
+
+    mul_frac(term, half_pi_u, argq, MPFR_RNDU);
+}
+
+void Evaluator::add_pending(const EquationView<Sin>& eq) {
+    pending_sines.push_back(eq);
+}
+
+void Evaluator::add_pending(const EquationView<Cos>& eq) {
+    pending_cosines.push_back(eq);
+}
+
+// The MPFR part of all_positive, for the equations that the double prefilter left in
+// pending_sines and pending_cosines
+bool Evaluator::pending_positive(const PointQ& center, const Extent& extent) {
+
+    // Start at a low precision, and only escalate the equations that are inconclusive
+    for (auto prec = start_precision;; prec = next_precision(prec)) {
+
+        if (pending_sines.empty() && pending_cosines.empty()) {
+            return true;
+        }
+
+        mpfr_clear_flags();
+
+        calculate_shared_bounds(center, prec);
+
+        // At the maximum precision there is no point in continuing after the first failure
+        const auto last = prec == precision;
+
+        failed_sines.clear();
+        failed_cosines.clear();
+
+        for (const auto& eq : pending_sines) {
+
+            sum_terms(eq);
+            bound_term(eq, extent);
+
+            if (mpfr_greater_p(sum, term)) {
+                ++histogram[prec];
+            } else {
+                failed_sines.push_back(eq);
 
-        if (flags & MPFR_FLAGS_UNDERFLOW) {
-            oss << "underflow\n";
+                if (last) {
+                    break;
+                }
+            }
         }
 
-        if (flags & MPFR_FLAGS_OVERFLOW) {
-            oss << "overflow\n";
+        if (!last || failed_sines.empty()) {
+            for (const auto& eq : pending_cosines) {
+
+                sum_terms(eq);
+                bound_term(eq, extent);
+
+                if (mpfr_greater_p(sum, term)) {
+                    ++histogram[prec];
+                } else {
+                    failed_cosines.push_back(eq);
+
+                    if (last) {
+                        break;
+                    }
+                }
+            }
         }
 
-        //if (flags & MPFR_FLAGS_DIVBY0) {
-            //oss << "divby0\n";
-        //}
+        const bool err = mpfr_underflow_p() || mpfr_overflow_p() || mpfr_nanflag_p() || mpfr_erangeflag_p();
+
+        if (err) {
+
+            std::ostringstream oss{};
+            oss << "error: flags raised in calculation of equations at point " << center
+                << " with " << (extent.segment ? "direction " : "radius ")
+                << extent.x << " " << extent.y << '\n';
+
+            if (mpfr_underflow_p()) {
+                oss << "underflow\n";
+            }
+
+            if (mpfr_overflow_p()) {
+                oss << "overflow\n";
+            }
+
+            if (mpfr_nanflag_p()) {
+                oss << "nan\n";
+            }
 
-        if (flags & MPFR_FLAGS_NAN) {
-            oss << "nan\n";
+            if (mpfr_erangeflag_p()) {
+                oss << "erange\n";
+            }
+
+            throw std::runtime_error(oss.str());
         }
 
-        if (flags & MPFR_FLAGS_ERANGE) {
-            oss << "erange\n";
+        if (last) {
+            return failed_sines.empty() && failed_cosines.empty();
         }
 
-        throw std::runtime_error(oss.str());
+        std::swap(pending_sines, failed_sines);
+        std::swap(pending_cosines, failed_cosines);
     }
-#endif
+}
 
-    const bool err = mpfr_underflow_p() || mpfr_overflow_p() || mpfr_nanflag_p() || mpfr_erangeflag_p();
+template <typename Info>
+bool Evaluator::all_positive(const Info& info, const PointQ& center, const Extent& extent,
+                             const RetiredEquations* const retired) {
 
-    if (err) {
+    // Most equations are decided by the double prefilter, so we only need
+    // to share the MPFR work between the ones that are left.
+    pending_sines.clear();
+    pending_cosines.clear();
 
-        std::ostringstream oss{};
-        oss << "error: flags raised in calculation of " << eq
-            << " at point " << center
-            << " with radius " << radius << '\n';
+    const auto finite = set_double_center(center);
+
+    for (size_t i = 0; i < info.sines.size(); ++i) {
 
-        if (mpfr_underflow_p()) {
-            oss << "underflow\n";
+        if (retired != nullptr && retired->sines.at(i)) {
+            continue;
         }
 
-        if (mpfr_overflow_p()) {
-            oss << "overflow\n";
+        const auto eq = info.sines[i];
+
+        if (finite && double_is_positive(eq, extent)) {
+            ++histogram[0];
+        } else {
+            pending_sines.push_back(eq);
         }
+    }
+
+    for (size_t i = 0; i < info.cosines.size(); ++i) {
 
-        if (mpfr_nanflag_p()) {
-            oss << "nan\n";
+        if (retired != nullptr && retired->cosines.at(i)) {
+            continue;
         }
 
-        if (mpfr_erangeflag_p()) {
-            oss << "erange\n";
+        const auto eq = info.cosines[i];
+
+        if (finite && double_is_positive(eq, extent)) {
+            ++histogram[0];
+        } else {
+            pending_cosines.push_back(eq);
         }
+    }
 
-        throw std::runtime_error(oss.str());
+    return pending_positive(center, extent);
+}
+
+template <typename Info>
+bool Evaluator::all_positive(const Info& info, const PointQ& center, const Rational& rx, const Rational& ry) {
+    return all_positive(info, center, Extent{rx, ry, false}, nullptr);
+}
+
+template bool Evaluator::all_positive(const StableInfo& info, const PointQ& center,
+                                      const Rational& rx, const Rational& ry);
+template bool Evaluator::all_positive(const UnstableInfo& info, const PointQ& center,
+                                      const Rational& rx, const Rational& ry);
+
+template <typename Info>
+bool Evaluator::all_positive(const Info& info, const PointQ& center, const Rational& rx, const Rational& ry,
+                             const RetiredEquations& retired) {
+    return all_positive(info, center, Extent{rx, ry, false}, &retired);
+}
+
+template bool Evaluator::all_positive(const StableInfo& info, const PointQ& center,
+                                      const Rational& rx, const Rational& ry, const RetiredEquations& retired);
+template bool Evaluator::all_positive(const UnstableInfo& info, const PointQ& center,
+                                      const Rational& rx, const Rational& ry, const RetiredEquations& retired);
+
+template <typename Info>
+size_t Evaluator::retire_positive(const Info& info, const PointQ& center, const Rational& rx, const Rational& ry,
+                                  RetiredEquations& retired) {
+
+    retired.sines.resize(info.sines.size(), false);
+    retired.cosines.resize(info.cosines.size(), false);
+
+    // Only the double prefilter, since this is a guess that saves work if it pays off, and the
+    // leaves still prove whatever is left
+    if (!set_double_center(center)) {
+        return 0;
+    }
+
+    const Extent extent{rx, ry, false};
+
+    size_t count = 0;
+
+    for (size_t i = 0; i < info.sines.size(); ++i) {
+        if (!retired.sines[i] && double_is_positive(info.sines[i], extent)) {
+            retired.sines[i] = true;
+            ++count;
+        }
+    }
+
+    for (size_t i = 0; i < info.cosines.size(); ++i) {
+        if (!retired.cosines[i] && double_is_positive(info.cosines[i], extent)) {
+            retired.cosines[i] = true;
+            ++count;
+        }
     }
 
-    return is_pos;
+    return count;
+}
+
+template size_t Evaluator::retire_positive(const StableInfo& info, const PointQ& center,
+                                           const Rational& rx, const Rational& ry, RetiredEquations& retired);
+template size_t Evaluator::retire_positive(const UnstableInfo& info, const PointQ& center,
+                                           const Rational& rx, const Rational& ry, RetiredEquations& retired);
+
+template <typename Info>
+bool Evaluator::all_positive_along(const Info& info, const PointQ& center, const Rational& dx, const Rational& dy) {
+    return all_positive(info, center, Extent{dx, dy, true}, nullptr);
+}
+
+template bool Evaluator::all_positive_along(const StableInfo& info, const PointQ& center,
+                                            const Rational& dx, const Rational& dy);
+template bool Evaluator::all_positive_along(const UnstableInfo& info, const PointQ& center,
+                                            const Rational& dx, const Rational& dy);
+
+template <template <typename> class Trig>
+bool Evaluator::is_positive_along(const EquationView<Trig>& eq,
+                                  const PointQ& center, const Rational& dx, const Rational& dy) {
+
+    const Extent extent{dx, dy, true};
+
+    if (set_double_center(center) && double_is_positive(eq, extent)) {
+        ++histogram[0];
+        return true;
+    }
+
+    pending_sines.clear();
+    pending_cosines.clear();
+
+    add_pending(eq);
+
+    return pending_positive(center, extent);
 }
 
-template bool Evaluator::is_positive(const EqVec<Sin>& eq, const Coeff64 bound,
-                                     const PointQ& center, const Rational& radius);
-template bool Evaluator::is_positive(const EqVec<Cos>& eq, const Coeff64 bound,
-                                     const PointQ& center, const Rational& radius);
+template bool Evaluator::is_positive_along(const EquationView<Sin>& eq,
+                                           const PointQ& center, const Rational& dx, const Rational& dy);
+template bool Evaluator::is_positive_along(const EquationView<Cos>& eq,
+                                           const PointQ& center, const Rational& dx, const Rational& dy);
@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include "farm.hpp"
+#include "progress.hpp"
+#include "util.hpp"
+
+static std::runtime_error farm_error(const std::string& what, const std::string& file) {
+    std::ostringstream err{};
+    err << "Farm: could not " << what << " " << file << ": " << std::strerror(errno);
+    return std::runtime_error(err.str());
+}
+
+static bool exists(const std::string& file) {
+    struct stat info{};
+    return ::stat(file.c_str(), &info) == 0;
+}
+
+static void make_dir(const std::string& dir) {
+    if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw farm_error("create", dir);
+    }
+}
+
+// Writes the file under a temporary name first and renames it into place, so that nobody
+// ever sees it half written
+static void write_file(const std::string& file, const std::string& contents) {
+
+    // Unique between processes, and between threads of one process
+    static std::atomic<uint64_t> counter{0};
+
+    std::ostringstream temp{};
+    temp << file << ".tmp." << ::getpid() << '.' << counter++;
+
+    {
+        std::ofstream output{temp.str()};
+        output << contents;
+        output.flush();
+
+        if (!output) {
+            throw farm_error("write", temp.str());
+        }
+    }
+
+    if (std::rename(temp.str().c_str(), file.c_str()) != 0) {
+        throw farm_error("rename", temp.str());
+    }
+}
+
+// The files in a directory, sorted, without any that are still being written
+static std::vector<std::string> list_dir(const std::string& dir) {
+
+    DIR* const handle = ::opendir(dir.c_str());
+
+    if (handle == nullptr) {
+        throw farm_error("open", dir);
+    }
+
+    std::vector<std::string> names{};
+
+    while (const auto* const entry = ::readdir(handle)) {
+
+        const std::string name{entry->d_name};
+
+        if (name != "." && name != ".." && name.find(".tmp.") == std::string::npos) {
+            names.push_back(name);
+        }
+    }
+
+    ::closedir(handle);
+
+    std::sort(std::begin(names), std::end(names));
+
+    return names;
+}
+
+// Zero padded, so the names sort the same as the ranks
+static std::string item_name(const size_t rank) {
+    std::ostringstream oss{};
+    oss << std::setw(10) << std::setfill('0') << rank;
+    return oss.str();
+}
+
+// The digest in hex, the same as in the journal and the shard results
+static std::string cover_line(const uint64_t digest) {
+    std::ostringstream oss{};
+    oss << "cover " << std::hex << std::setw(16) << std::setfill('0') << digest << '\n';
+    return oss.str();
+}
+
+static std::string farm_header(const uint64_t digest, const size_t items) {
+    std::ostringstream oss{};
+    oss << "# cover farm\n" << cover_line(digest) << "items " << items << '\n';
+    return oss.str();
+}
+
+// Whether the worker has touched its file within the timeout
+static bool is_alive(const std::string& spool, const std::string& worker, const FarmOptions& options) {
+
+    struct stat info{};
+
+    if (::stat((spool + "/workers/" + worker).c_str(), &info) != 0) {
+        return false;
+    }
+
+    const auto touched = std::chrono::system_clock::from_time_t(info.st_mtime);
+
+    return std::chrono::system_clock::now() - touched < options.timeout;
+}
+
+bool run_coordinator(const std::string& spool, const uint64_t digest, const std::vector<std::string>& paths,
+                     const FarmOptions& options) {
+
+    for (const auto dir : {"", "/todo", "/claimed", "/done", "/workers"}) {
+        make_dir(spool + dir);
+    }
+
+    const auto header = farm_header(digest, paths.size());
+
+    if (exists(spool + "/farm") && read_file(spool + "/farm") != header) {
+        std::ostringstream err{};
+        err << "run_coordinator: " << spool << " is for a different cover";
+        throw std::runtime_error(err.str());
+    }
+
+    // Anything that is nowhere yet goes into todo. On a restart that is only what was lost.
+    {
+        std::set<std::string> placed{};
+
+        for (const auto& name : list_dir(spool + "/todo")) {
+            placed.insert(name);
+        }
+
+        for (const auto& name : list_dir(spool + "/done")) {
+            placed.insert(name);
+        }
+
+        for (const auto& name : list_dir(spool + "/claimed")) {
+            placed.insert(name.substr(0, name.find('.')));
+        }
+
+        for (size_t rank = 0; rank < paths.size(); ++rank) {
+            if (placed.count(item_name(rank)) == 0) {
+                write_file(spool + "/todo/" + item_name(rank), paths.at(rank));
+            }
+        }
+    }
+
+    // Only now can the workers start
+    write_file(spool + "/farm", header);
+
+    std::set<std::string> done{};
+
+    {
+        Progress progress{"Farming cover: ", paths.size()};
+
+        while (true) {
+
+            for (const auto& name : list_dir(spool + "/done")) {
+                if (done.insert(name).second) {
+                    ++progress;
+                }
+            }
+
+            if (done.size() == paths.size()) {
+                break;
+            }
+
+            // Items go back into todo if their worker died, and are cleaned up if they were
+            // done by someone else in the meantime
+            for (const auto& name : list_dir(spool + "/claimed")) {
+
+                const auto dot = name.find('.');
+                const auto item = name.substr(0, dot);
+                const auto worker = name.substr(dot + 1);
+
+                const auto claim = spool + "/claimed/" + name;
+
+                if (done.count(item) != 0) {
+                    std::remove(claim.c_str());
+                } else if (!is_alive(spool, worker, options)) {
+                    std::rename(claim.c_str(), (spool + "/todo/" + item).c_str());
+                }
+            }
+
+            for (const auto& name : list_dir(spool + "/todo")) {
+                if (done.count(name) != 0) {
+                    std::remove((spool + "/todo/" + name).c_str());
+                }
+            }
+
+            std::this_thread::sleep_for(options.poll);
+        }
+    }
+
+    write_file(spool + "/stop", header);
+
+    bool covered = true;
+
+    for (size_t rank = 0; rank < paths.size(); ++rank) {
+
+        auto result = read_file(spool + "/done/" + item_name(rank));
+        boost::trim(result);
+
+        if (result != "covered yes") {
+            std::cout << "Failure: subtree " << (paths.at(rank).empty() ? "(root)" : paths.at(rank)) << " was not covered" << std::endl;
+            covered = false;
+        }
+    }
+
+    return covered;
+}
+
+// Touches the file of a worker every heartbeat, until it is destroyed
+class Heartbeat final {
+  private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopped;
+    std::thread thrd;
+
+  public:
+    explicit Heartbeat(const std::string& file, const std::string& id, const FarmOptions& options)
+        : stopped{false} {
+
+        // Alive before claiming anything
+        write_file(file, id);
+
+        thrd = std::thread{[this, file, id, options] {
+
+            std::unique_lock<std::mutex> lock{mutex};
+
+            while (!condition.wait_for(lock, options.heartbeat, [this] { return stopped; })) {
+                // An exception would end the whole worker, and a missed heartbeat is only a
+                // problem if the next ones are missed too, so try again next time
+                try {
+                    write_file(file, id);
+                } catch (const std::exception& e) {
+                    std::cerr << "Heartbeat: " << e.what() << std::endl;
+                }
+            }
+        }};
+    }
+
+    Heartbeat(const Heartbeat&) = delete;
+    Heartbeat& operator=(const Heartbeat&) = delete;
+
+    ~Heartbeat() {
+        {
+            const std::lock_guard<std::mutex> lock{mutex};
+            stopped = true;
+        }
+
+        condition.notify_one();
+        thrd.join();
+    }
+};
+
+uint64_t run_worker(const std::string& spool, const uint64_t digest, const std::string& id,
+                    const std::function<bool(const std::string&)>& verify, const FarmOptions& options) {
+
+    if (id.empty() || id.find('/') != std::string::npos) {
+        std::ostringstream err{};
+        err << "run_worker: invalid worker id " << id;
+        throw std::runtime_error(err.str());
+    }
+
+    // Wait for the coordinator to set everything up
+    while (!exists(spool + "/farm")) {
+        std::this_thread::sleep_for(options.poll);
+    }
+
+    const auto header = read_file(spool + "/farm");
+
+    if (header.find(cover_line(digest)) == std::string::npos) {
+        std::ostringstream err{};
+        err << "run_worker: " << spool << " is for a different cover";
+        throw std::runtime_error(err.str());
+    }
+
+    uint64_t checked = 0;
+
+    {
+        const Heartbeat heartbeat{spool + "/workers/" + id, id, options};
+
+        while (!exists(spool + "/stop")) {
+
+            bool claimed = false;
+
+            for (const auto& name : list_dir(spool + "/todo")) {
+
+                const auto claim = spool + "/claimed/" + name + "." + id;
+
+                // Whoever renames it first has it
+                if (std::rename((spool + "/todo/" + name).c_str(), claim.c_str()) != 0) {
+                    continue;
+                }
+
+                claimed = true;
+
+                const auto path = read_file(claim);
+                const auto covered = verify(path);
+
+                write_file(spool + "/done/" + name, covered ? "covered yes\n" : "covered no\n");
+
+                // The coordinator may have given it to someone else in the meantime
+                std::remove(claim.c_str());
+
+                ++checked;
+
+                break;
+            }
+
+            if (!claimed) {
+                std::this_thread::sleep_for(options.poll);
+            }
+        }
+    }
+
+    std::remove((spool + "/workers/" + id).c_str());
+
+    return checked;
+}
+
+std::string default_worker_id() {
+
+    char host[256] = {};
+
+    if (::gethostname(host, sizeof(host) - 1) != 0) {
+        std::strcpy(host, "localhost");
+    }
+
+    std::ostringstream oss{};
+    oss << host << '-' << ::getpid();
+    return oss.str();
+}
@@ -0,0 +1,100 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "info_cache.hpp"
+
+InfoCache::InfoCache(const std::vector<CodePair>& singles, const std::vector<TriplePair>& triples, const CodeUses& uses,
+                     const InfoStore* const store_)
+    : singles_{singles},
+      triples_{triples},
+      store{store_},
+      loaded{0},
+      peak_{0} {
+
+    add_uses(uses);
+}
+
+template <typename Info>
+void InfoCache::add_uses(Table<Info>& table, const std::map<size_t, uint64_t>& uses) {
+
+    for (const auto& kv : uses) {
+
+        typename Table<Info>::accessor accessor{};
+
+        // A new entry has not been calculated yet
+        if (table.insert(accessor, kv.first)) {
+            accessor->second = Entry<Info>{nullptr, 0};
+        }
+
+        accessor->second.uses += kv.second;
+    }
+}
+
+void InfoCache::add_uses(const CodeUses& uses) {
+    add_uses(single_table, uses.singles);
+    add_uses(triple_table, uses.triples);
+}
+
+template <typename Info, typename Pair, typename Calculate>
+std::shared_ptr<const Info> InfoCache::acquire(Table<Info>& table, const std::vector<Pair>& pairs,
+                                               const size_t index, const Calculate& calculate) {
+
+    // This locks the entry, so anyone else after the same code waits for it to be calculated,
+    // while every other code is still available
+    typename Table<Info>::accessor accessor{};
+
+    if (!table.find(accessor, index)) {
+        std::ostringstream err{};
+        err << "InfoCache: code " << index << " acquired after its last use";
+        throw std::runtime_error(err.str());
+    }
+
+    auto& entry = accessor->second;
+
+    if (!entry.info) {
+        entry.info = std::make_shared<const Info>(calculate(pairs.at(index), store));
+
+        const auto now = ++loaded;
+
+        // Another thread may raise the peak between the load and the exchange, so retry
+        auto peak = peak_.load();
+        while (now > peak && !peak_.compare_exchange_weak(peak, now)) {
+        }
+    }
+
+    return entry.info;
+}
+
+template <typename Info>
+void InfoCache::release(Table<Info>& table, const size_t index) {
+
+    typename Table<Info>::accessor accessor{};
+
+    if (!table.find(accessor, index) || !accessor->second.info) {
+        std::ostringstream err{};
+        err << "InfoCache: code " << index << " released without being acquired";
+        throw std::runtime_error(err.str());
+    }
+
+    // Whoever still holds the info keeps it alive until they are done with it
+    if (--accessor->second.uses == 0) {
+        table.erase(accessor);
+        --loaded;
+    }
+}
+
+std::shared_ptr<const StableInfo> InfoCache::acquire_single(const size_t index) {
+    return acquire(single_table, singles_, index, calculate_single_info);
+}
+
+std::shared_ptr<const TripleInfo> InfoCache::acquire_triple(const size_t index) {
+    return acquire(triple_table, triples_, index, calculate_triple_info);
+}
+
+void InfoCache::release_single(const size_t index) {
+    release(single_table, index);
+}
+
+void InfoCache::release_triple(const size_t index) {
+    release(triple_table, index);
+}
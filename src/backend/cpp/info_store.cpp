@@ -0,0 +1,576 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <tbb/parallel_for.h>
+
+#include "info_store.hpp"
+#include "progress.hpp"
+
+// Change this whenever calculate_code_info or calculate_triple_code_info start to give
+// different results, so that old stores are refused
+constexpr uint32_t info_version = 1;
+
+constexpr uint32_t format_version = 1;
+constexpr uint32_t byte_order_mark = 0x01020304;
+
+struct StoreHeader final {
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;
+    uint32_t info;
+    uint32_t reserved;
+    uint64_t entries;
+    uint64_t index_offset;
+};
+
+struct IndexEntry final {
+    uint64_t hash;
+    uint64_t key_offset;
+    uint64_t value_offset;
+    uint32_t key_size;
+    uint32_t value_size;
+};
+
+static_assert(sizeof(StoreHeader) == 40, "StoreHeader must not have padding");
+static_assert(sizeof(IndexEntry) == 32, "IndexEntry must not have padding");
+
+static const char store_magic[8] = {'C', 'O', 'V', 'R', 'I', 'N', 'F', 'O'};
+
+static std::runtime_error store_error(const std::string& what, const std::string& file) {
+    std::ostringstream err{};
+    err << "InfoStore: could not " << what << " " << file << ": " << std::strerror(errno);
+    return std::runtime_error(err.str());
+}
+
+static std::runtime_error corrupt_store(const std::string& file, const std::string& why) {
+    std::ostringstream err{};
+    err << "InfoStore: " << file << " is " << why;
+    return std::runtime_error(err.str());
+}
+
+// 64 bit FNV-1a
+static uint64_t fnv1a(const std::string& str) {
+
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (const auto c : str) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+template <typename T>
+static std::string to_string(const T& value) {
+    std::ostringstream oss{};
+    oss << value;
+    return oss.str();
+}
+
+// Codes and triples never have the same text, but keep them apart anyway
+static std::string code_key(const CodePair& code_pair) {
+    return "code " + to_string(code_pair);
+}
+
+static std::string triple_key(const TriplePair& triple_pair) {
+    return "triple " + to_string(triple_pair);
+}
+
+// Appends the infos to a value
+class ValueWriter final {
+
+  private:
+    std::string& value;
+
+    template <typename T>
+    void put(const T number) {
+        value.append(reinterpret_cast<const char*>(&number), sizeof(number));
+    }
+
+    void put_string(const std::string& str) {
+        put(static_cast<uint32_t>(str.size()));
+        value.append(str);
+    }
+
+    template <template <typename> class Trig>
+    void put_equations(const std::set<EqMap<Trig>>& equations) {
+
+        put(static_cast<uint32_t>(equations.size()));
+
+        for (const auto& equation : equations) {
+
+            put(static_cast<uint32_t>(equation.size()));
+
+            for (const auto& kv : equation) {
+                put(static_cast<int32_t>(kv.second));
+                put(static_cast<int32_t>(kv.first.arg.coeff(XY::X)));
+                put(static_cast<int32_t>(kv.first.arg.coeff(XY::Y)));
+            }
+        }
+    }
+
+  public:
+    explicit ValueWriter(std::string& value_)
+        : value{value_} {}
+
+    void put_code_info(const CodeInfo& code_info) {
+
+        put(static_cast<uint32_t>(code_info.points.size()));
+
+        for (const auto& point : code_info.points) {
+            put_string(to_string(point.x));
+            put_string(to_string(point.y));
+        }
+
+        put_equations(code_info.sin_equations);
+        put_equations(code_info.cos_equations);
+    }
+};
+
+// Reads the infos back out of a value in the mapped file
+class ValueReader final {
+
+  private:
+    const std::string& file;
+    const char* pos;
+    const char* const end;
+
+    template <typename T>
+    T get() {
+
+        if (static_cast<size_t>(end - pos) < sizeof(T)) {
+            throw corrupt_store(file, "corrupt, a value is cut off");
+        }
+
+        // The value may not be aligned, so copy it out instead of casting
+        T number{};
+        std::memcpy(&number, pos, sizeof(T));
+        pos += sizeof(T);
+
+        return number;
+    }
+
+    std::string get_string() {
+
+        const auto size = get<uint32_t>();
+
+        if (static_cast<size_t>(end - pos) < size) {
+            throw corrupt_store(file, "corrupt, a value is cut off");
+        }
+
+        std::string str{pos, size};
+        pos += size;
+
+        return str;
+    }
+
+    template <template <typename> class Trig>
+    std::set<EqMap<Trig>> get_equations() {
+
+        std::set<EqMap<Trig>> equations{};
+
+        const auto count = get<uint32_t>();
+
+        for (uint32_t i = 0; i < count; ++i) {
+
+            EqMap<Trig> equation{};
+
+            const auto terms = get<uint32_t>();
+
+            for (uint32_t j = 0; j < terms; ++j) {
+
+                const auto t = get<int32_t>();
+                const auto x = get<int32_t>();
+                const auto y = get<int32_t>();
+
+                equation.add(static_cast<Coeff32>(t), Trig<LinComArrZ<XY>>{LinComArrZ<XY>{static_cast<Coeff32>(x), static_cast<Coeff32>(y)}});
+            }
+
+            equations.insert(std::move(equation));
+        }
+
+        return equations;
+    }
+
+  public:
+    explicit ValueReader(const std::string& file_, const char* const begin, const char* const end_)
+        : file{file_},
+          pos{begin},
+          end{end_} {}
+
+    CodeInfo get_code_info() {
+
+        std::vector<PointQ> points{};
+
+        const auto count = get<uint32_t>();
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const Rational x{get_string()};
+            const Rational y{get_string()};
+            points.emplace_back(x, y);
+        }
+
+        auto sin_equations = get_equations<Sin>();
+        auto cos_equations = get_equations<Cos>();
+
+        return CodeInfo{std::move(points), std::move(sin_equations), std::move(cos_equations)};
+    }
+
+    bool done() const {
+        return pos == end;
+    }
+};
+
+static void check_header(const std::string& file, const char* const data, const size_t size,
+                         StoreHeader& header) {
+
+    if (size < sizeof(StoreHeader)) {
+        throw corrupt_store(file, "too small to be a store");
+    }
+
+    std::memcpy(&header, data, sizeof(StoreHeader));
+
+    if (!std::equal(std::begin(store_magic), std::end(store_magic), header.magic)) {
+        throw corrupt_store(file, "not a store");
+    }
+
+    if (header.format != format_version || header.byte_order != byte_order_mark) {
+        throw corrupt_store(file, "in a format or byte order that this build can not read");
+    }
+
+    if (header.info != info_version) {
+        throw corrupt_store(file, "from a build that calculates the infos differently, please precompute it again");
+    }
+
+    if (header.index_offset > size || (size - header.index_offset) % sizeof(IndexEntry) != 0 ||
+        (size - header.index_offset) / sizeof(IndexEntry) != header.entries) {
+        throw corrupt_store(file, "corrupt, the index does not fit");
+    }
+}
+
+InfoStore::InfoStore(const std::string& file)
+    : file_name{file},
+      data{nullptr},
+      size{0},
+      entries{0},
+      index_offset{0} {
+
+    const auto fd = ::open(file.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw store_error("open", file);
+    }
+
+    struct stat info{};
+
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw store_error("stat", file);
+    }
+
+    size = static_cast<size_t>(info.st_size);
+
+    // An empty mapping is an error, and an empty file is no store anyway
+    if (size == 0) {
+        ::close(fd);
+        throw corrupt_store(file, "empty");
+    }
+
+    void* const mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid without the file descriptor
+    ::close(fd);
+
+    if (mapped == MAP_FAILED) {
+        throw store_error("map", file);
+    }
+
+    data = static_cast<const char*>(mapped);
+
+    try {
+        StoreHeader header{};
+        check_header(file, data, size, header);
+
+        entries = header.entries;
+        index_offset = header.index_offset;
+    } catch (...) {
+        ::munmap(const_cast<char*>(data), size);
+        throw;
+    }
+}
+
+InfoStore::~InfoStore() {
+    ::munmap(const_cast<char*>(data), size);
+}
+
+boost::optional<std::pair<const char*, const char*>> InfoStore::find(const std::string& key) const {
+
+    const auto entry_at = [this](const uint64_t i) {
+        IndexEntry entry{};
+        std::memcpy(&entry, data + index_offset + i * sizeof(IndexEntry), sizeof(IndexEntry));
+        return entry;
+    };
+
+    const auto hash = fnv1a(key);
+
+    // The first entry with the hash
+    uint64_t low = 0;
+    uint64_t high = entries;
+
+    while (low < high) {
+
+        const auto mid = low + (high - low) / 2;
+
+        if (entry_at(mid).hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    // Different keys can have the same hash
+    for (auto i = low; i < entries; ++i) {
+
+        const auto entry = entry_at(i);
+
+        if (entry.hash != hash) {
+            break;
+        }
+
+        if (entry.key_offset > index_offset || index_offset - entry.key_offset < entry.key_size ||
+            entry.value_offset > index_offset || index_offset - entry.value_offset < entry.value_size) {
+            throw corrupt_store(file_name, "corrupt, an entry is outside of the values");
+        }
+
+        if (key.compare(0, std::string::npos, data + entry.key_offset, entry.key_size) == 0) {
+            const auto* const value = data + entry.value_offset;
+            return std::make_pair(value, value + entry.value_size);
+        }
+    }
+
+    return boost::none;
+}
+
+boost::optional<CodeInfo> InfoStore::code_info(const CodePair& code_pair) const {
+
+    const auto value = find(code_key(code_pair));
+
+    if (!value) {
+        return boost::none;
+    }
+
+    ValueReader reader{file_name, value->first, value->second};
+
+    auto code_info = reader.get_code_info();
+
+    if (!reader.done()) {
+        throw corrupt_store(file_name, "corrupt, a value is too long");
+    }
+
+    return code_info;
+}
+
+boost::optional<TripleCodeInfo> InfoStore::triple_code_info(const TriplePair& triple_pair) const {
+
+    const auto value = find(triple_key(triple_pair));
+
+    if (!value) {
+        return boost::none;
+    }
+
+    ValueReader reader{file_name, value->first, value->second};
+
+    auto stable_neg = reader.get_code_info();
+    auto unstable = reader.get_code_info();
+    auto stable_pos = reader.get_code_info();
+
+    if (!reader.done()) {
+        throw corrupt_store(file_name, "corrupt, a value is too long");
+    }
+
+    return TripleCodeInfo{std::move(stable_neg), std::move(unstable), std::move(stable_pos)};
+}
+
+std::unique_ptr<const InfoStore> load_info_store(const std::string& file) {
+
+    struct stat info{};
+
+    if (::stat(file.c_str(), &info) != 0) {
+        return nullptr;
+    }
+
+    return std::unique_ptr<const InfoStore>{new InfoStore{file}};
+}
+
+std::string default_info_store(const std::string& cover_dir) {
+    return cover_dir + "/infos.store";
+}
+
+void write_info_store(const std::string& file,
+                      const std::vector<CodePair>& codes,
+                      const std::vector<TriplePair>& triples,
+                      const InfoStore* const old) {
+
+    // Every distinct key once, along with how to calculate its value
+    std::map<std::string, const CodePair*> code_keys{};
+    std::map<std::string, const TriplePair*> triple_keys{};
+
+    for (const auto& code_pair : codes) {
+        code_keys.emplace(code_key(code_pair), &code_pair);
+    }
+
+    for (const auto& triple_pair : triples) {
+        triple_keys.emplace(triple_key(triple_pair), &triple_pair);
+    }
+
+    std::vector<std::string> keys{};
+    std::vector<std::function<std::string()>> calculate{};
+
+    for (const auto& kv : code_keys) {
+
+        const auto& code_pair = *kv.second;
+
+        keys.push_back(kv.first);
+        calculate.emplace_back([&code_pair] {
+            std::string value{};
+            ValueWriter{value}.put_code_info(calculate_code_info(code_pair));
+            return value;
+        });
+    }
+
+    for (const auto& kv : triple_keys) {
+
+        const auto& triple_pair = *kv.second;
+
+        keys.push_back(kv.first);
+        calculate.emplace_back([&triple_pair] {
+            const auto code_info = calculate_triple_code_info(triple_pair);
+
+            std::string value{};
+            ValueWriter writer{value};
+            writer.put_code_info(code_info.stable_neg);
+            writer.put_code_info(code_info.unstable);
+            writer.put_code_info(code_info.stable_pos);
+            return value;
+        });
+    }
+
+    std::vector<std::string> values(keys.size());
+    std::atomic<uint64_t> copied{0};
+
+    {
+        Progress progress{"Precomputing infos: ", keys.size()};
+
+        tbb::parallel_for(size_t{0}, keys.size(), [&](const size_t i) {
+
+            boost::optional<std::pair<const char*, const char*>> found{};
+
+            if (old != nullptr) {
+                found = old->find(keys.at(i));
+            }
+
+            if (found) {
+                values.at(i).assign(found->first, found->second);
+                ++copied;
+            } else {
+                values.at(i) = calculate.at(i)();
+            }
+
+            ++progress;
+        });
+    }
+
+    if (copied != 0) {
+        std::cout << "Copied " << copied << " of " << keys.size() << " infos from the old store" << std::endl;
+    }
+
+    // Lay out the values and keys after the header, and then the index
+    std::string contents(sizeof(StoreHeader), '\0');
+    std::vector<IndexEntry> index{};
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+
+        IndexEntry entry{};
+        entry.hash = fnv1a(keys.at(i));
+
+        entry.key_offset = contents.size();
+        entry.key_size = static_cast<uint32_t>(keys.at(i).size());
+        contents += keys.at(i);
+
+        entry.value_offset = contents.size();
+        entry.value_size = static_cast<uint32_t>(values.at(i).size());
+        contents += values.at(i);
+
+        index.push_back(entry);
+    }
+
+    std::sort(std::begin(index), std::end(index), [](const IndexEntry& lhs, const IndexEntry& rhs) {
+        return lhs.hash < rhs.hash;
+    });
+
+    StoreHeader header{};
+    std::copy(std::begin(store_magic), std::end(store_magic), header.magic);
+    header.format = format_version;
+    header.byte_order = byte_order_mark;
+    header.info = info_version;
+    header.entries = index.size();
+    header.index_offset = contents.size();
+
+    std::memcpy(&contents[0], &header, sizeof(StoreHeader));
+
+    for (const auto& entry : index) {
+        contents.append(reinterpret_cast<const char*>(&entry), sizeof(IndexEntry));
+    }
+
+    // Readers may have the old store mapped, so write a new file and rename it over the old one
+    const auto temp = file + ".tmp." + std::to_string(::getpid());
+
+    const auto fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        throw store_error("open", temp);
+    }
+
+    for (size_t written = 0; written < contents.size();) {
+
+        const auto count = ::write(fd, contents.data() + written, contents.size() - written);
+
+        if (count < 0 && errno != EINTR) {
+            ::close(fd);
+            throw store_error("write", temp);
+        }
+
+        written += static_cast<size_t>(std::max<ssize_t>(count, 0));
+    }
+
+    // Otherwise a crash soon after the rename may leave the new name with none of the contents
+    if (::fsync(fd) != 0) {
+        ::close(fd);
+        throw store_error("sync", temp);
+    }
+
+    if (::close(fd) != 0) {
+        throw store_error("close", temp);
+    }
+
+    if (std::rename(temp.c_str(), file.c_str()) != 0) {
+        throw store_error("rename", temp);
+    }
+
+    std::cout << "Wrote " << keys.size() << " infos to " << file << std::endl;
+}
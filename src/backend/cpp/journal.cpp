@@ -0,0 +1,183 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal.hpp"
+
+constexpr size_t Journal::batch_size;
+constexpr std::chrono::seconds Journal::batch_time;
+
+// Any change to the files of the cover changes the digest, not only to the number of leaves,
+// so a journal is never used with codes or a polygon that it was not proved with
+static std::string journal_header(const uint64_t cover) {
+    std::ostringstream oss{};
+    oss << "# cover journal, cover " << std::hex << std::setw(16) << std::setfill('0') << cover;
+    return oss.str();
+}
+
+static std::runtime_error journal_error(const std::string& what, const std::string& file) {
+    std::ostringstream err{};
+    err << "Journal: could not " << what << " " << file << ": " << std::strerror(errno);
+    return std::runtime_error(err.str());
+}
+
+Journal::Journal(const std::string& file, const uint64_t cover, const bool append)
+    : file_name{file},
+      fd{-1},
+      pending{0},
+      last_sync{std::chrono::steady_clock::now()} {
+
+    const auto flags = O_WRONLY | O_CREAT | O_APPEND | (append ? 0 : O_TRUNC);
+
+    fd = ::open(file.c_str(), flags, 0644);
+
+    if (fd < 0) {
+        throw journal_error("open", file);
+    }
+
+    struct stat info{};
+
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw journal_error("stat", file);
+    }
+
+    // If we were killed in the middle of a write, the last line may be incomplete. Appending
+    // to it could turn it into a different path, so cut it off.
+    if (info.st_size > 0) {
+
+        std::ifstream input{file};
+        const std::string contents{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+
+        const auto end = contents.rfind('\n');
+        const auto size = end == std::string::npos ? 0 : end + 1;
+
+        if (size != contents.size() && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            throw journal_error("truncate", file);
+        }
+
+        info.st_size = static_cast<off_t>(size);
+    }
+
+    // A new journal needs its header before anything else
+    if (info.st_size == 0) {
+        buffer = journal_header(cover) + '\n';
+        write_buffer();
+    }
+}
+
+Journal::~Journal() {
+
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+    }
+
+    ::close(fd);
+}
+
+// Write out the buffer and sync it. The mutex must be held, or the journal not yet shared.
+void Journal::write_buffer() {
+
+    size_t written = 0;
+
+    while (written < buffer.size()) {
+
+        const auto result = ::write(fd, buffer.data() + written, buffer.size() - written);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw journal_error("write", file_name);
+        }
+
+        written += static_cast<size_t>(result);
+    }
+
+    if (::fsync(fd) != 0) {
+        throw journal_error("sync", file_name);
+    }
+
+    buffer.clear();
+    pending = 0;
+    last_sync = std::chrono::steady_clock::now();
+}
+
+void Journal::record(const std::string& path) {
+
+    const std::lock_guard<std::mutex> lock{mutex};
+
+    buffer += path;
+    buffer += '\n';
+    ++pending;
+
+    if (pending >= batch_size || std::chrono::steady_clock::now() - last_sync >= batch_time) {
+        write_buffer();
+    }
+}
+
+void Journal::flush() {
+
+    const std::lock_guard<std::mutex> lock{mutex};
+
+    if (!buffer.empty()) {
+        write_buffer();
+    }
+}
+
+std::set<std::string> load_journal(const std::string& file, const uint64_t cover) {
+
+    std::ifstream input{file};
+
+    if (!input) {
+        return {};
+    }
+
+    const std::string contents{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+
+    std::set<std::string> paths{};
+
+    size_t start = 0;
+    bool header = true;
+
+    // Only complete lines count. A partial last line is from a write that did not finish.
+    for (auto end = contents.find('\n'); end != std::string::npos; end = contents.find('\n', start)) {
+
+        const auto line = contents.substr(start, end - start);
+        start = end + 1;
+
+        if (header) {
+            if (line != journal_header(cover)) {
+                std::ostringstream err{};
+                err << "load_journal: " << file << " is for a different cover";
+                throw std::runtime_error(err.str());
+            }
+
+            header = false;
+            continue;
+        }
+
+        if (line.find_first_not_of("0123") != std::string::npos) {
+            std::ostringstream err{};
+            err << "load_journal: invalid path " << line << " in " << file;
+            throw std::runtime_error(err.str());
+        }
+
+        paths.insert(line);
+    }
+
+    return paths;
+}
@@ -0,0 +1,334 @@
+#include <algorithm> // std::max
+#include <cmath>     // std::abs
+#include <cstring>   // std::memcpy
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define INTERVAL_KERNEL_AVX2 1
+#include <immintrin.h>
+#endif
+
+#include "math/interval_kernel.hpp"
+
+namespace math {
+
+void PowerArrays::clear() {
+    re_.clear();
+    im_.clear();
+    rad_.clear();
+}
+
+bool PowerArrays::extend(UnitPowers& powers, const size_t n) {
+
+    while (re_.size() <= n) {
+
+        const auto power = powers(static_cast<int64_t>(re_.size()));
+
+        const auto re = power.re.midpoint();
+        const auto im = power.im.midpoint();
+
+        // The distance from the midpoint to any point in the rectangle
+        const auto re_rad = std::max(re - power.re.lower(), power.re.upper() - re);
+        const auto im_rad = std::max(im - power.im.lower(), power.im.upper() - im);
+
+        const auto rad = DoubleInterval::up(DoubleInterval::up(re_rad) + DoubleInterval::up(im_rad));
+
+        if (!(rad <= max_radius)) {
+            return false;
+        }
+
+        re_.push_back(re);
+        im_.push_back(im);
+        rad_.push_back(rad);
+    }
+
+    return true;
+}
+
+// The error analysis, with u = 2^-53 the unit roundoff.
+//
+// Let x and y be the stored midpoints of s^a and t^b, with radii rx and ry. Since
+// |s^a| = |t^b| = 1, we have
+//
+//     |x*y - s^a*t^b| <= |x - s^a| * |y| + |s^a| * |y - t^b| <= rx + ry + rx*ry
+//
+// Each part of the computed complex product has a rounding error of at most 2u*|x|*|y|, which
+// is less than 3u since the radii are tiny. Multiplying by t, t*a or t*b (which may itself be
+// rounded) adds another 2u relative error, and summing n terms adds at most n*u times the sum
+// of their absolute values. So the error of each sum is at most
+//
+//     sum of |c| * (rx + ry + rx*ry + 4 * (n + 8) * u)
+//
+// where c is t, t*a or t*b. We calculate these error sums in floating point too, but since
+// every term is positive, their relative error is at most (n + 4) * u, and multiplying them
+// by 1 + 2^-20 at the end covers that (for any n we will ever see).
+
+static double term_slack(const size_t size) {
+    const double unit_roundoff = 1.0 / (1LL << 53);
+    return 4 * (static_cast<double>(size) + 8) * unit_roundoff;
+}
+
+static const double error_scale = 1 + 1.0 / (1 << 20);
+
+template <typename Coeff>
+static void add_term(const bool sine, const TermArrays<Coeff>& terms, const size_t i,
+                     const PowerArrays& x, const PowerArrays& y,
+                     const double rx, const double ry, const double slack,
+                     TermSums& sums) {
+
+    const auto t = static_cast<double>(terms.t[i]);
+    const auto a = static_cast<double>(terms.a[i]);
+    const auto b = static_cast<double>(terms.b[i]);
+
+    const auto abs_a = static_cast<size_t>(std::abs(static_cast<int64_t>(terms.a[i])));
+    const auto abs_b = static_cast<size_t>(std::abs(static_cast<int64_t>(terms.b[i])));
+
+    // z^{-k} = conj(z^k)
+    const auto sign_a = a < 0 ? -1.0 : 1.0;
+    const auto sign_b = b < 0 ? -1.0 : 1.0;
+
+    const auto xr = x.re()[abs_a];
+    const auto xi = sign_a * x.im()[abs_a];
+    const auto yr = y.re()[abs_b];
+    const auto yi = sign_b * y.im()[abs_b];
+
+    const auto pr = xr * yr - xi * yi;
+    const auto pi = xr * yi + xi * yr;
+
+    // sin = Im, sin' = cos = Re, cos = Re, cos' = -sin = -Im
+    const auto trig = sine ? pi : pr;
+    const auto deriv = sine ? pr : -pi;
+
+    const auto err = x.rad()[abs_a] + y.rad()[abs_b] + x.rad()[abs_a] * y.rad()[abs_b] + slack;
+
+    const auto ta = t * a;
+    const auto tb = t * b;
+
+    sums.value += t * trig;
+    sums.value_error += std::abs(t) * err;
+
+    sums.dx += ta * deriv;
+    sums.dx_error += std::abs(ta) * err;
+
+    sums.dy += tb * deriv;
+    sums.dy_error += std::abs(tb) * err;
+
+    const auto spread = static_cast<double>(abs_a) * rx + static_cast<double>(abs_b) * ry;
+
+    sums.curvature += std::abs(t) * spread * spread;
+}
+
+static TermSums finish(TermSums sums) {
+
+    sums.value_error *= error_scale;
+    sums.dx_error *= error_scale;
+    sums.dy_error *= error_scale;
+    sums.curvature *= error_scale;
+
+    return sums;
+}
+
+template <typename Coeff>
+TermSums sum_terms_scalar(const bool sine, const TermArrays<Coeff>& terms,
+                          const PowerArrays& x, const PowerArrays& y,
+                          const double rx, const double ry) {
+
+    const auto slack = term_slack(terms.size);
+
+    TermSums sums{0, 0, 0, 0, 0, 0, 0};
+
+    for (size_t i = 0; i < terms.size; ++i) {
+        add_term(sine, terms, i, x, y, rx, ry, slack, sums);
+    }
+
+    return finish(sums);
+}
+
+#ifdef INTERVAL_KERNEL_AVX2
+
+static double horizontal_sum(const __m256d vec) __attribute__((target("avx2")));
+
+static double horizontal_sum(const __m256d vec) {
+
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, vec);
+
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+static __m256d gather(const double* base, const __m128i index) __attribute__((target("avx2")));
+
+// base[index] for each of the four indices. The plain _mm256_i32gather_pd leaves its source
+// operand undefined, which makes GCC warn, so we use the masked version with every lane set.
+static __m256d gather(const double* base, const __m128i index) {
+    const auto mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, index, mask, 8);
+}
+
+static __m128i load_coeffs(const int8_t* coeffs) __attribute__((target("avx2")));
+static __m128i load_coeffs(const int16_t* coeffs) __attribute__((target("avx2")));
+static __m128i load_coeffs(const int32_t* coeffs) __attribute__((target("avx2")));
+
+// Four coefficients, sign extended to 32 bits
+static __m128i load_coeffs(const int8_t* coeffs) {
+    int32_t packed;
+    std::memcpy(&packed, coeffs, sizeof(packed));
+    return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed));
+}
+
+static __m128i load_coeffs(const int16_t* coeffs) {
+    return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(coeffs)));
+}
+
+static __m128i load_coeffs(const int32_t* coeffs) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(coeffs));
+}
+
+template <typename Coeff>
+static TermSums sum_terms_avx2(const bool sine, const TermArrays<Coeff>& terms,
+                               const PowerArrays& x, const PowerArrays& y,
+                               const double rx, const double ry) __attribute__((target("avx2")));
+
+// The same as sum_terms_scalar, but four terms at a time. The sums are added in a different
+// order, but the error analysis above does not depend on it.
+template <typename Coeff>
+static TermSums sum_terms_avx2(const bool sine, const TermArrays<Coeff>& terms,
+                               const PowerArrays& x, const PowerArrays& y,
+                               const double rx, const double ry) {
+
+    const auto slack = term_slack(terms.size);
+
+    const auto slack_v = _mm256_set1_pd(slack);
+    const auto rx_v = _mm256_set1_pd(rx);
+    const auto ry_v = _mm256_set1_pd(ry);
+
+    // Clearing the sign bit gives the absolute value
+    const auto sign_bit = _mm256_set1_pd(-0.0);
+
+    const auto one = _mm_set1_epi32(1);
+
+    auto value = _mm256_setzero_pd();
+    auto value_error = _mm256_setzero_pd();
+    auto dx = _mm256_setzero_pd();
+    auto dx_error = _mm256_setzero_pd();
+    auto dy = _mm256_setzero_pd();
+    auto dy_error = _mm256_setzero_pd();
+    auto curvature = _mm256_setzero_pd();
+
+    size_t i = 0;
+
+    for (; i + 4 <= terms.size; i += 4) {
+
+        const auto t32 = load_coeffs(terms.t + i);
+        const auto a32 = load_coeffs(terms.a + i);
+        const auto b32 = load_coeffs(terms.b + i);
+
+        const auto abs_a32 = _mm_abs_epi32(a32);
+        const auto abs_b32 = _mm_abs_epi32(b32);
+
+        // -1, 0 or 1. For k = 0 the imaginary part is exactly 0, so 0 works as well as 1.
+        const auto sign_a = _mm256_cvtepi32_pd(_mm_sign_epi32(one, a32));
+        const auto sign_b = _mm256_cvtepi32_pd(_mm_sign_epi32(one, b32));
+
+        const auto t = _mm256_cvtepi32_pd(t32);
+        const auto a = _mm256_cvtepi32_pd(a32);
+        const auto b = _mm256_cvtepi32_pd(b32);
+
+        const auto xr = gather(x.re(), abs_a32);
+        const auto xi = _mm256_mul_pd(sign_a, gather(x.im(), abs_a32));
+        const auto xrad = gather(x.rad(), abs_a32);
+
+        const auto yr = gather(y.re(), abs_b32);
+        const auto yi = _mm256_mul_pd(sign_b, gather(y.im(), abs_b32));
+        const auto yrad = gather(y.rad(), abs_b32);
+
+        const auto pr = _mm256_sub_pd(_mm256_mul_pd(xr, yr), _mm256_mul_pd(xi, yi));
+        const auto pi = _mm256_add_pd(_mm256_mul_pd(xr, yi), _mm256_mul_pd(xi, yr));
+
+        const auto trig = sine ? pi : pr;
+        const auto deriv = sine ? pr : _mm256_xor_pd(pi, sign_bit);
+
+        const auto err = _mm256_add_pd(_mm256_add_pd(xrad, yrad),
+                                       _mm256_add_pd(_mm256_mul_pd(xrad, yrad), slack_v));
+
+        const auto abs_t = _mm256_andnot_pd(sign_bit, t);
+
+        const auto ta = _mm256_mul_pd(t, a);
+        const auto tb = _mm256_mul_pd(t, b);
+
+        value = _mm256_add_pd(value, _mm256_mul_pd(t, trig));
+        value_error = _mm256_add_pd(value_error, _mm256_mul_pd(abs_t, err));
+
+        dx = _mm256_add_pd(dx, _mm256_mul_pd(ta, deriv));
+        dx_error = _mm256_add_pd(dx_error, _mm256_mul_pd(_mm256_andnot_pd(sign_bit, ta), err));
+
+        dy = _mm256_add_pd(dy, _mm256_mul_pd(tb, deriv));
+        dy_error = _mm256_add_pd(dy_error, _mm256_mul_pd(_mm256_andnot_pd(sign_bit, tb), err));
+
+        const auto spread = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(abs_a32), rx_v),
+                                          _mm256_mul_pd(_mm256_cvtepi32_pd(abs_b32), ry_v));
+
+        curvature = _mm256_add_pd(curvature, _mm256_mul_pd(abs_t, _mm256_mul_pd(spread, spread)));
+    }
+
+    TermSums sums{horizontal_sum(value), horizontal_sum(value_error),
+                  horizontal_sum(dx), horizontal_sum(dx_error),
+                  horizontal_sum(dy), horizontal_sum(dy_error),
+                  horizontal_sum(curvature)};
+
+    // The leftover terms
+    for (; i < terms.size; ++i) {
+        add_term(sine, terms, i, x, y, rx, ry, slack, sums);
+    }
+
+    return finish(sums);
+}
+
+#endif
+
+bool has_avx2_kernel() {
+#ifdef INTERVAL_KERNEL_AVX2
+    static const bool avx2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+template <typename Coeff>
+TermSums sum_terms(const bool sine, const TermArrays<Coeff>& terms,
+                   const PowerArrays& x, const PowerArrays& y,
+                   const double rx, const double ry) {
+
+#ifdef INTERVAL_KERNEL_AVX2
+    if (has_avx2_kernel()) {
+        return sum_terms_avx2(sine, terms, x, y, rx, ry);
+    }
+#endif
+
+    return sum_terms_scalar(sine, terms, x, y, rx, ry);
+}
+
+template TermSums sum_terms(const bool sine, const TermArrays<int8_t>& terms,
+                            const PowerArrays& x, const PowerArrays& y,
+                            const double rx, const double ry);
+template TermSums sum_terms(const bool sine, const TermArrays<int16_t>& terms,
+                            const PowerArrays& x, const PowerArrays& y,
+                            const double rx, const double ry);
+template TermSums sum_terms(const bool sine, const TermArrays<int32_t>& terms,
+                            const PowerArrays& x, const PowerArrays& y,
+                            const double rx, const double ry);
+
+template TermSums sum_terms_scalar(const bool sine, const TermArrays<int8_t>& terms,
+                                   const PowerArrays& x, const PowerArrays& y,
+                                   const double rx, const double ry);
+template TermSums sum_terms_scalar(const bool sine, const TermArrays<int16_t>& terms,
+                                   const PowerArrays& x, const PowerArrays& y,
+                                   const double rx, const double ry);
+template TermSums sum_terms_scalar(const bool sine, const TermArrays<int32_t>& terms,
+                                   const PowerArrays& x, const PowerArrays& y,
+                                   const double rx, const double ry);
+}
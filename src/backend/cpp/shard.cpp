@@ -0,0 +1,220 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+
+#include "shard.hpp"
+#include "util.hpp"
+
+// 64 bit FNV-1a
+static uint64_t fnv1a(const std::string& str, uint64_t hash = 0xcbf29ce484222325) {
+
+    for (const auto c : str) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+static std::string to_hex(const uint64_t value) {
+    std::ostringstream oss{};
+    oss << std::hex << std::setw(16) << std::setfill('0') << value;
+    return oss.str();
+}
+
+static uint64_t from_hex(const std::string& str) {
+
+    if (str.size() != 16 || str.find_first_not_of("0123456789abcdef") != std::string::npos) {
+        std::ostringstream err{};
+        err << "from_hex: invalid digest " << str;
+        throw std::runtime_error(err.str());
+    }
+
+    return std::stoull(str, nullptr, 16);
+}
+
+Shard parse_shard(const std::string& str) {
+
+    const auto parts = split(str, "/");
+
+    const auto is_number = [](const std::string& part) {
+        return !part.empty() && part.find_first_not_of("0123456789") == std::string::npos;
+    };
+
+    if (parts.size() != 2 || !is_number(parts.at(0)) || !is_number(parts.at(1))) {
+        std::ostringstream err{};
+        err << "parse_shard: expected index/count, got " << str;
+        throw std::runtime_error(err.str());
+    }
+
+    const Shard shard{std::stoul(parts.at(0)), std::stoul(parts.at(1))};
+
+    if (shard.index >= shard.count) {
+        std::ostringstream err{};
+        err << "parse_shard: index " << shard.index << " is not less than count " << shard.count;
+        throw std::runtime_error(err.str());
+    }
+
+    return shard;
+}
+
+uint64_t cover_digest(const std::string& dir) {
+
+    uint64_t hash = fnv1a("");
+
+    for (const auto name : {"square.txt", "polygon.txt", "stables.txt", "triples.txt", "cover.txt", "precision.txt"}) {
+        // Include the name, so moving contents between files changes the digest
+        hash = fnv1a(name, hash);
+        hash = fnv1a(read_file(dir + "/" + name), hash);
+    }
+
+    return hash;
+}
+
+// Everything but the digest
+static std::string format_result(const ShardResult& result) {
+
+    std::ostringstream oss{};
+
+    oss << "# cover shard result\n";
+    oss << "cover " << to_hex(result.cover) << '\n';
+    oss << "shard " << result.shard.index << '/' << result.shard.count << '\n';
+    oss << "leaves " << result.leaves << '\n';
+    oss << "covered " << (result.covered ? "yes" : "no") << '\n';
+
+    return oss.str();
+}
+
+void write_shard_result(const std::string& file, const ShardResult& result) {
+
+    const auto body = format_result(result);
+
+    // Write it all to a temporary file first, so there is never a partial result under the
+    // real name
+    const auto temp = file + ".tmp";
+
+    {
+        std::ofstream output{temp};
+
+        output << body << "digest " << to_hex(fnv1a(body)) << '\n';
+        output.flush();
+
+        if (!output) {
+            std::ostringstream err{};
+            err << "write_shard_result: could not write " << temp;
+            throw std::runtime_error(err.str());
+        }
+    }
+
+    if (std::rename(temp.c_str(), file.c_str()) != 0) {
+        std::ostringstream err{};
+        err << "write_shard_result: could not rename " << temp << " to " << file;
+        throw std::runtime_error(err.str());
+    }
+}
+
+ShardResult load_shard_result(const std::string& file) {
+
+    const auto contents = read_file(file);
+
+    const auto digest_start = contents.rfind("digest ");
+
+    if (digest_start == std::string::npos) {
+        std::ostringstream err{};
+        err << "load_shard_result: no digest in " << file;
+        throw std::runtime_error(err.str());
+    }
+
+    const auto body = contents.substr(0, digest_start);
+    auto digest = contents.substr(digest_start + 7);
+    boost::trim(digest);
+
+    if (from_hex(digest) != fnv1a(body)) {
+        std::ostringstream err{};
+        err << "load_shard_result: digest does not match in " << file;
+        throw std::runtime_error(err.str());
+    }
+
+    std::istringstream input{body};
+
+    std::string header{};
+    std::getline(input, header);
+
+    std::string cover_key{};
+    std::string cover{};
+    std::string shard_key{};
+    std::string shard{};
+    std::string leaves_key{};
+    uint64_t leaves{};
+    std::string covered_key{};
+    std::string covered{};
+
+    input >> cover_key >> cover >> shard_key >> shard >> leaves_key >> leaves >> covered_key >> covered;
+
+    if (!input || header != "# cover shard result" || cover_key != "cover" || shard_key != "shard" ||
+        leaves_key != "leaves" || covered_key != "covered" || (covered != "yes" && covered != "no")) {
+        std::ostringstream err{};
+        err << "load_shard_result: invalid result in " << file;
+        throw std::runtime_error(err.str());
+    }
+
+    return ShardResult{from_hex(cover), parse_shard(shard), leaves, covered == "yes"};
+}
+
+bool merge_shard_results(const std::vector<ShardResult>& results, const uint64_t digest, const std::vector<ShardPlan>& plan) {
+
+    std::vector<bool> seen(plan.size(), false);
+
+    bool covered = true;
+
+    for (const auto& result : results) {
+
+        const auto index = result.shard.index;
+
+        if (result.cover != digest) {
+            std::cout << "Failure: shard " << index << " is of a different cover" << std::endl;
+            covered = false;
+            continue;
+        }
+
+        if (result.shard.count != plan.size()) {
+            std::cout << "Failure: shard " << index << " is one of " << result.shard.count
+                      << " shards, not " << plan.size() << std::endl;
+            covered = false;
+            continue;
+        }
+
+        if (seen.at(index)) {
+            std::cout << "Failure: more than one result for shard " << index << std::endl;
+            covered = false;
+            continue;
+        }
+
+        seen.at(index) = true;
+
+        if (result.leaves != plan.at(index).leaves) {
+            std::cout << "Failure: shard " << index << " has " << result.leaves
+                      << " leaves, expected " << plan.at(index).leaves << std::endl;
+            covered = false;
+        }
+
+        if (!result.covered) {
+            std::cout << "Failure: shard " << index << " was not covered" << std::endl;
+            covered = false;
+        }
+    }
+
+    for (size_t i = 0; i < seen.size(); ++i) {
+        if (!seen.at(i)) {
+            std::cout << "Failure: no result for shard " << i << std::endl;
+            covered = false;
+        }
+    }
+
+    return covered;
+}
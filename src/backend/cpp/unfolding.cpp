@@ -1,36 +1,74 @@
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include <tbb/concurrent_unordered_set.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
 #include "unfolding.hpp"
 #include "division.hpp"
 #include "trig_identities.hpp"
 
-static std::vector<Vertex> find_path(const Vertex& start, const Vertex& end) {
+// The vector of a single edge
+static PathVector edge_vector(const Edge& edge) {
 
-    std::vector<Vertex> path{};
+    EqMap<Sin> coord_x{};
+    EqMap<Cos> coord_y{};
 
-    // if it is on the outside, move back into the main thing
-    if (start.branch != 0) {
-        path.push_back(start);
-    }
+    // a = edge.polar_angle
+    // b = edge.edge_type
 
-    // now we move up or down until we get there
-    // at most one of the following two loops will execute
-    // this will add (start.number, Position.MAIN) for us already
-    for (auto i = start.number; i < end.number; ++i) {
-        path.emplace_back(i, 0);
-    }
+    const auto sum = LinComArrZ<XYPi>::add(edge.polar_angle, xyz_to_xypi(edge.edge_type));
+    const auto diff = LinComArrZ<XYPi>::sub(edge.polar_angle, xyz_to_xypi(edge.edge_type));
 
-    for (auto i = start.number; i > end.number; --i) {
-        path.emplace_back(i, 0);
-    }
+    const auto sin_sum = simplify_sin_xypi(sum);
+    const auto sin_diff = simplify_sin_xypi(diff);
 
-    // move over to the end
-    path.emplace_back(end.number, 0);
+    // cos(a) * sin(b) = 1/2 sin(a + b) - 1/2 sin(a - b)
+    coord_x.add(sin_sum.first, sin_sum.second);
+    coord_x.sub(sin_diff.first, sin_diff.second);
 
-    // move out on a branch if necessary
-    if (end.branch != 0) {
-        path.push_back(end);
+    const auto cos_sum = simplify_cos_xypi(sum);
+    const auto cos_diff = simplify_cos_xypi(diff);
+
+    // sin(a) * sin(b) = 1/2 cos(a - b) - 1/2 cos(a + b)
+    coord_y.add(cos_diff.first, cos_diff.second);
+    coord_y.sub(cos_sum.first, cos_sum.second);
+
+    return {coord_x, coord_y};
+}
+
+static void add_vector(PathVector& lhs, const PathVector& rhs) {
+    lhs.first.add(rhs.first);
+    lhs.second.add(rhs.second);
+}
+
+// The coefficients of vector for each of the terms, which must include all of its terms
+template <typename Term, typename Map>
+static std::vector<Coeff32> dense_coeffs(const std::vector<Term>& terms, const Map& vector) {
+
+    std::vector<Coeff32> coeffs(terms.size(), 0);
+
+    auto term = std::begin(terms);
+
+    // Both are sorted, so this is a merge
+    for (const auto& kv : vector) {
+
+        term = std::lower_bound(term, std::end(terms), kv.first);
+        coeffs.at(static_cast<size_t>(term - std::begin(terms))) = kv.second;
     }
 
-    return path;
+    return coeffs;
+}
+
+// The number of vertices on the walk from start to end, counting both of them
+static size_t path_length(const Vertex& start, const Vertex& end) {
+
+    const auto main = start.number < end.number ? end.number - start.number : start.number - end.number;
+
+    return main + 1 + (start.branch != 0 ? 1 : 0) + (end.branch != 0 ? 1 : 0);
 }
 
 // TODO we need to change the orientation of the vertices so they are flipped around
@@ -51,18 +89,20 @@ Unfolding::Unfolding(const std::vector<CodeNumber>& tmp_code_numbers, const std:
 
     // 2 <- 1
     const LinComArrZ<XYPi> pi{0, 0, 1};
-    // Butt ugly, but hey, that's C++
-    edges.emplace(std::make_pair(std::make_pair(first_vertex, second_vertex), Edge{current_side, pi}));
+    up_edges.emplace_back(current_side, pi);
 
     // 2 -> 1
     const LinComArrZ<XYPi> zero{};
-    edges.emplace(std::make_pair(std::make_pair(second_vertex, first_vertex), Edge{current_side, zero}));
+    down_edges.emplace_back(current_side, zero);
 
     // the angle going backwards along the chain, so from 2 -> 1 in this case
     LinComArrZ<XYPi> prev_polar_angle{};
 
     const auto size = code_numbers.size();
 
+    // the main vertices are numbered from 1 to size + 2
+    branch_edges.resize(size + 3);
+
     // really should use a zip in this case
     for (size_t i = 0; i < size; i += 1) {
         // Actually, unsigned integer overflow is defined to wrap
@@ -97,12 +137,12 @@ Unfolding::Unfolding(const std::vector<CodeNumber>& tmp_code_numbers, const std:
         current_to_next_main_polar_angle.add(current_code_number * side, current_code_angle_pi);
 
         // current_main_vertex -> next_main_vertex
-        edges.emplace(std::make_pair(std::make_pair(current_main_vertex, next_main_vertex), Edge{main_edge_type, current_to_next_main_polar_angle}));
+        up_edges.emplace_back(main_edge_type, current_to_next_main_polar_angle);
 
         // next_main_vertex -> current_main_vertex
         // this variable name is now wrong, but whatevs
         current_to_next_main_polar_angle.add(XYPi::Pi);
-        edges.emplace(std::make_pair(std::make_pair(next_main_vertex, current_main_vertex), Edge{main_edge_type, current_to_next_main_polar_angle}));
+        down_edges.emplace_back(main_edge_type, current_to_next_main_polar_angle);
 
         // now add the branches
 
@@ -116,13 +156,13 @@ Unfolding::Unfolding(const std::vector<CodeNumber>& tmp_code_numbers, const std:
             main_to_middle_polar_angle.add(prev_polar_angle);
             main_to_middle_polar_angle.add(side, current_code_angle_pi);
 
-            // inserting makes a copy of the stuff
+            // the edge makes a copy of the angle
             // which is what we want, because we mutate it after
-            edges.emplace(std::make_pair(std::make_pair(current_main_vertex, middle_vertex), Edge{prev_code_angle, main_to_middle_polar_angle}));
+            const Edge main_to_middle{prev_code_angle, main_to_middle_polar_angle};
 
             // Again, the variable name is now incorrect
             main_to_middle_polar_angle.add(XYPi::Pi);
-            edges.emplace(std::make_pair(std::make_pair(middle_vertex, current_main_vertex), Edge{prev_code_angle, main_to_middle_polar_angle}));
+            branch_edges.at(current_number).at(0) = std::make_pair(main_to_middle, Edge{prev_code_angle, main_to_middle_polar_angle});
 
             add_vertices.push_back(middle_vertex);
         } else if (current_code_number >= 3) {
@@ -134,11 +174,11 @@ Unfolding::Unfolding(const std::vector<CodeNumber>& tmp_code_numbers, const std:
             main_to_lower_polar_angle.add(prev_polar_angle);
             main_to_lower_polar_angle.add(side, current_code_angle_pi);
 
-            edges.emplace(std::make_pair(std::make_pair(current_main_vertex, lower_vertex), Edge{prev_code_angle, main_to_lower_polar_angle}));
+            const Edge main_to_lower{prev_code_angle, main_to_lower_polar_angle};
 
             // Again, the variable name is now wrong
             main_to_lower_polar_angle.add(XYPi::Pi);
-            edges.emplace(std::make_pair(std::make_pair(lower_vertex, current_main_vertex), Edge{prev_code_angle, main_to_lower_polar_angle}));
+            branch_edges.at(current_number).at(0) = std::make_pair(main_to_lower, Edge{prev_code_angle, main_to_lower_polar_angle});
 
             add_vertices.push_back(lower_vertex);
 
@@ -148,11 +188,11 @@ Unfolding::Unfolding(const std::vector<CodeNumber>& tmp_code_numbers, const std:
             main_to_upper_polar_angle.add(prev_polar_angle);
             main_to_upper_polar_angle.add(side * (current_code_number - 1), current_code_angle_pi);
 
-            edges.emplace(std::make_pair(std::make_pair(current_main_vertex, upper_vertex), Edge{next_code_angle, main_to_upper_polar_angle}));
+            const Edge main_to_upper{next_code_angle, main_to_upper_polar_angle};
 
             // Again, variable name is now wrong
             main_to_upper_polar_angle.add(XYPi::Pi);
-            edges.emplace(std::make_pair(std::make_pair(upper_vertex, current_main_vertex), Edge{next_code_angle, main_to_upper_polar_angle}));
+            branch_edges.at(current_number).at(1) = std::make_pair(main_to_upper, Edge{next_code_angle, main_to_upper_polar_angle});
 
             add_vertices.push_back(upper_vertex);
         }
@@ -163,131 +203,298 @@ Unfolding::Unfolding(const std::vector<CodeNumber>& tmp_code_numbers, const std:
         // to do it here
         prev_polar_angle = current_to_next_main_polar_angle;
     }
-}
 
-// given an unfolding and a path from one point to another, this gives the vector going from the first point to the second.
-// The first coordinate is x, the second y
-std::pair<EqMap<Sin>, EqMap<Cos>> Unfolding::path_vector(const std::vector<Vertex>& path) const {
+    // Every walk along the main chain is a difference of two of these. The walks down use the
+    // edges down, rather than the negated walks up, so that the vectors come out exactly as if
+    // the edges were added up one by one.
+    std::vector<PathVector> up_vectors{};
+    std::vector<PathVector> down_vectors{};
 
-    //std::vector<std::pair<Sin<XYZ>, Cos<LinComArrZ<XYPi>>>> xs{};
-    //std::vector<std::pair<Sin<XYZ>, Sin<LinComArrZ<XYPi>>>> ys{};
+    up_vectors.emplace_back(EqMap<Sin>{}, EqMap<Cos>{});
+    down_vectors.emplace_back(EqMap<Sin>{}, EqMap<Cos>{});
 
-    EqMap<Sin> coord_x{};
-    EqMap<Cos> coord_y{};
+    for (size_t k = 0; k < up_edges.size(); ++k) {
 
-    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        auto up_sum = up_vectors.at(k);
+        add_vector(up_sum, edge_vector(up_edges.at(k)));
+        up_vectors.push_back(std::move(up_sum));
 
-        const Vertex current_vertex = path.at(i);
-        const Vertex next_vertex = path.at(i + 1);
+        auto down_sum = down_vectors.at(k);
+        add_vector(down_sum, edge_vector(down_edges.at(k)));
+        down_vectors.push_back(std::move(down_sum));
+    }
 
-        const Edge& current_edge = edges.at({current_vertex, next_vertex});
+    std::vector<std::array<boost::optional<std::pair<PathVector, PathVector>>, 2>> branch_path_vectors(branch_edges.size());
 
-        //xs.emplace_back(Sin<XYZ>{current_edge.edge_type}, Cos<LinComArrZ<XYPi>>{current_edge.polar_angle});
-        //ys.emplace_back(Sin<XYZ>{current_edge.edge_type}, Sin<LinComArrZ<XYPi>>{current_edge.polar_angle});
+    for (size_t number = 0; number < branch_edges.size(); ++number) {
+        for (size_t b = 0; b < 2; ++b) {
+            if (const auto& edge_pair = branch_edges.at(number).at(b)) {
+                branch_path_vectors.at(number).at(b) = std::make_pair(edge_vector(edge_pair->first), edge_vector(edge_pair->second));
+            }
+        }
+    }
 
-        // a = current_edge.polar_angle
-        // b = current_edge.edge_type
+    // Every vector between two vertices is made of the terms of these
+    std::set<Sin<LinComArrZ<XY>>> sins{};
+    std::set<Cos<LinComArrZ<XY>>> coses{};
 
-        const auto sum = LinComArrZ<XYPi>::add(current_edge.polar_angle, xyz_to_xypi(current_edge.edge_type));
-        const auto diff = LinComArrZ<XYPi>::sub(current_edge.polar_angle, xyz_to_xypi(current_edge.edge_type));
+    const auto add_terms = [&](const PathVector& vector) {
+        for (const auto& term : vector.first) {
+            sins.insert(term.first);
+        }
 
-        const auto sin_sum = simplify_sin_xypi(sum);
-        const auto sin_diff = simplify_sin_xypi(diff);
+        for (const auto& term : vector.second) {
+            coses.insert(term.first);
+        }
+    };
 
-        // cos(a) * sin(b) = 1/2 sin(a + b) - 1/2 sin(a - b)
-        coord_x.add(sin_sum.first, sin_sum.second);
-        coord_x.sub(sin_diff.first, sin_diff.second);
+    for (const auto& vector : up_vectors) {
+        add_terms(vector);
+    }
 
-        const auto cos_sum = simplify_cos_xypi(sum);
-        const auto cos_diff = simplify_cos_xypi(diff);
+    for (const auto& vector : down_vectors) {
+        add_terms(vector);
+    }
+
+    for (const auto& branches : branch_path_vectors) {
+        for (const auto& vector_pair : branches) {
+            if (vector_pair) {
+                add_terms(vector_pair->first);
+                add_terms(vector_pair->second);
+            }
+        }
+    }
+
+    sin_terms.assign(std::begin(sins), std::end(sins));
+    cos_terms.assign(std::begin(coses), std::end(coses));
+
+    const auto dense = [&](const PathVector& vector) {
+        return DenseVector{dense_coeffs(sin_terms, vector.first), dense_coeffs(cos_terms, vector.second)};
+    };
 
-        // sin(a) * sin(b) = 1/2 cos(a - b) - 1/2 cos(a + b)
-        coord_y.add(cos_diff.first, cos_diff.second);
-        coord_y.sub(cos_sum.first, cos_sum.second);
+    for (const auto& vector : up_vectors) {
+        up_sums.push_back(dense(vector));
     }
 
-    /*
-    bool first = true;
-    for (const auto& p : xs) {
-        if (!first) {
-            std::cout << '+';
+    for (const auto& vector : down_vectors) {
+        down_sums.push_back(dense(vector));
+    }
+
+    branch_vectors.resize(branch_path_vectors.size());
+
+    for (size_t number = 0; number < branch_path_vectors.size(); ++number) {
+        for (size_t b = 0; b < 2; ++b) {
+            if (const auto& vector_pair = branch_path_vectors.at(number).at(b)) {
+                branch_vectors.at(number).at(b) = std::make_pair(dense(vector_pair->first), dense(vector_pair->second));
+            }
         }
+    }
+}
 
-        std::cout << p.first << '*' << p.second;
-        first = false;
+// The vectors out to a branch vertex and back in to the main chain
+const std::pair<DenseVector, DenseVector>& Unfolding::branch_vector(const Vertex& vertex) const {
+
+    const auto& vector_pair = branch_vectors.at(vertex.number).at(vertex.branch - 1);
+
+    if (!vector_pair) {
+        std::ostringstream message{};
+        message << "Unfolding: no branch vertex " << vertex;
+        throw std::runtime_error(message.str());
     }
-    std::cout << std::endl;
 
-    first = true;
-    for (const auto& p : ys) {
-        if (!first) {
-            std::cout << '+';
+    return *vector_pair;
+}
+
+// vector = plus - minus, plus the branch vectors that are not null
+static void combine(std::vector<Coeff32>& vector,
+                    const std::vector<Coeff32>* const plus, const std::vector<Coeff32>* const minus,
+                    const std::vector<Coeff32>* const out, const std::vector<Coeff32>* const in) {
+
+    std::fill(std::begin(vector), std::end(vector), 0);
+
+    for (const auto* const add : {plus, out, in}) {
+        if (add != nullptr) {
+            for (size_t t = 0; t < vector.size(); ++t) {
+                vector[t] += (*add)[t];
+            }
         }
+    }
 
-        std::cout << p.first << '*' << p.second;
-        first = false;
+    if (minus != nullptr) {
+        for (size_t t = 0; t < vector.size(); ++t) {
+            vector[t] -= (*minus)[t];
+        }
     }
-    std::cout << std::endl;
-    */
+}
 
-    //std::cout << xs << std::endl;
-    //std::cout << ys << std::endl;
+// given an unfolding and two of its vertices, this gives the vector going from the first point to the second.
+// The first coordinate is x, the second y
+void Unfolding::pair_vector(const Vertex& start, const Vertex& end, DenseVector& vector) const {
 
-    return {coord_x, coord_y};
+    vector.x.resize(sin_terms.size());
+    vector.y.resize(cos_terms.size());
+
+    // if it is on the outside, move back into the main thing
+    const auto* const in = start.branch != 0 ? &branch_vector(start).second : nullptr;
+
+    // now we move up or down until we get there
+    const DenseVector* plus = nullptr;
+    const DenseVector* minus = nullptr;
+
+    if (start.number < end.number) {
+        plus = &up_sums.at(end.number - 1);
+        minus = &up_sums.at(start.number - 1);
+    } else if (start.number > end.number) {
+        plus = &down_sums.at(start.number - 1);
+        minus = &down_sums.at(end.number - 1);
+    }
+
+    // move out on a branch if necessary
+    const auto* const out = end.branch != 0 ? &branch_vector(end).first : nullptr;
+
+    combine(vector.x, plus != nullptr ? &plus->x : nullptr, minus != nullptr ? &minus->x : nullptr,
+            out != nullptr ? &out->x : nullptr, in != nullptr ? &in->x : nullptr);
+
+    combine(vector.y, plus != nullptr ? &plus->y : nullptr, minus != nullptr ? &minus->y : nullptr,
+            out != nullptr ? &out->y : nullptr, in != nullptr ? &in->y : nullptr);
 }
 
-std::pair<EqMap<Sin>, EqMap<Cos>> Unfolding::shooting_vector_general() const {
+PathVector Unfolding::shooting_vector_general() const {
 
     const Vertex first_left = left_vertices.at(0);
     const Vertex last_left = left_vertices.at(left_vertices.size() - 1);
 
-    const auto shooting_path_left = find_path(first_left, last_left);
-
     const Vertex first_right = right_vertices.at(0);
     const Vertex last_right = right_vertices.at(right_vertices.size() - 1);
 
-    const auto shooting_path_right = find_path(first_right, last_right);
+    DenseVector vector{};
 
     // Pick the shorter path
-    const auto& shooting_path = shooting_path_left.size() < shooting_path_right.size() ? shooting_path_left : shooting_path_right;
+    if (path_length(first_left, last_left) < path_length(first_right, last_right)) {
+        pair_vector(first_left, last_left, vector);
+    } else {
+        pair_vector(first_right, last_right, vector);
+    }
+
+    PathVector path_vector{EqMap<Sin>{}, EqMap<Cos>{}};
 
-    const auto shooting_vector = path_vector(shooting_path);
+    for (size_t t = 0; t < sin_terms.size(); ++t) {
+        path_vector.first.add(vector.x[t], sin_terms[t]);
+    }
 
-    return shooting_vector;
+    for (size_t t = 0; t < cos_terms.size(); ++t) {
+        path_vector.second.add(vector.y[t], cos_terms[t]);
+    }
+
+    return path_vector;
 }
 
+// A 64 bit FNV-1a fingerprint of an equation, from its coefficients and the coefficients of
+// their arguments
+struct EquationFingerprint final {
+    template <template <typename> class Trig>
+    size_t operator()(const EqMap<Trig>& equation) const {
+
+        uint64_t hash = 0xcbf29ce484222325;
+
+        const auto mix = [&](const int64_t value) {
+            hash ^= static_cast<uint64_t>(value);
+            hash *= 0x100000001b3;
+        };
+
+        for (const auto& term : equation) {
+            mix(term.second);
+            mix(term.first.arg.template coeff<XY::X>());
+            mix(term.first.arg.template coeff<XY::Y>());
+        }
+
+        return static_cast<size_t>(hash);
+    }
+};
+
 template <template <typename> class T, template <typename> class S>
 Curves Unfolding::generate_curves(const EqMap<T>& shooting_vector_x, const EqMap<S>& shooting_vector_y, const InitialAngles& initial_angles, const PointQ& center, const Rational& rx, const Rational& ry) const {
 
-    Inserter insert{center, rx, ry};
+    using Product = decltype(multiply_lin_com(shooting_vector_y, std::declval<EqMap<Sin>>()));
+
+    // Every path vector is made of the terms of the prefix sums and the branch edges, and its
+    // products with the shooting vector are sums of the products with each of its terms. So the
+    // products with the terms are worked out once for the whole code, and the loop below only
+    // adds them up.
+    std::vector<Product> x_products{};
+    std::vector<Product> y_products{};
+
+    for (const auto& term : sin_terms) {
+        x_products.push_back(multiply_lin_com(shooting_vector_y, EqMap<Sin>{{term, 1}}));
+    }
+
+    for (const auto& term : cos_terms) {
+        y_products.push_back(multiply_lin_com(EqMap<Cos>{{term, 1}}, shooting_vector_x));
+    }
+
+    // Many pairs of vertices give the same equation, and each distinct one only needs to be
+    // divided and checked once. The set compares whole equations, so the fingerprint only picks
+    // the bucket, and a collision can't make us lose an equation.
+    tbb::concurrent_unordered_set<Product, EquationFingerprint> seen{};
+
+    // Each thread has its own Inserter, which also gives each one the Evaluator of its own thread.
+    // Since the curves go into sets, merging them at the end gives exactly the same curves as
+    // going through the pairs in order.
+    tbb::enumerable_thread_specific<Inserter> inserters{[&] { return Inserter{center, rx, ry}; }};
 
     // we don't need to get the equations for the last vertices on the left and right sides, since those wrap around
     // and are the same as the first points on the left and right
-    for (size_t i = 0; i < left_vertices.size() - 1; i += 1) {
+    const auto row = [&](const size_t i) {
+        auto& insert = inserters.local();
+
+        DenseVector path_vec{};
+
         const Vertex left_vertex = left_vertices.at(i);
         for (size_t j = 0; j < right_vertices.size() - 1; j += 1) {
             const Vertex right_vertex = right_vertices.at(j);
 
-            const auto path = find_path(left_vertex, right_vertex);
+            pair_vector(left_vertex, right_vertex, path_vec);
 
-            const auto path_vec = path_vector(path);
+            // equation = path_vector_x * shooting_vector_y - shooting_vector_x * path_vector_y;
+            Product equation{};
 
-            const auto& path_vector_x = path_vec.first;
-            const auto& path_vector_y = path_vec.second;
+            for (size_t t = 0; t < path_vec.x.size(); ++t) {
+                if (path_vec.x[t] != 0) {
+                    equation.add(path_vec.x[t], x_products[t]);
+                }
+            }
 
-            // equation = path_vector_x * shooting_vector_y - shooting_vector_x * path_vector_y;
-            auto first = multiply_lin_com(shooting_vector_y, path_vector_x);
+            for (size_t t = 0; t < path_vec.y.size(); ++t) {
+                if (path_vec.y[t] != 0) {
+                    equation.sub(path_vec.y[t], y_products[t]);
+                }
+            }
 
-            const auto second = multiply_lin_com(path_vector_y, shooting_vector_x);
+            equation.divide_content();
 
-            first.sub(second);
-            first.divide_content();
+            if (!seen.insert(equation).second) {
+                continue;
+            }
 
-            divide_out_lines(first, initial_angles.first, initial_angles.second, insert);
+            divide_out_lines(equation, initial_angles.first, initial_angles.second, insert);
         }
+    };
+
+    // We are usually called from a parallel loop over the codes, or while InfoCache holds the
+    // lock of the code. Isolating the loop keeps this thread from picking up another code while
+    // it waits, which could need the same lock.
+    tbb::this_task_arena::isolate([&] {
+        tbb::parallel_for(size_t{0}, left_vertices.size() - 1, row);
+    });
+
+    Curves curves{};
+
+    for (const auto& insert : inserters) {
+        curves.first.insert(std::begin(insert.curves.first), std::end(insert.curves.first));
+        curves.second.insert(std::begin(insert.curves.second), std::end(insert.curves.second));
     }
 
-    return insert.curves;
+    return curves;
 }
 
 template Curves Unfolding::generate_curves(const EqMap<Sin>& shooting_vector_x, const EqMap<Cos>& shooting_vector_y, const InitialAngles& initial_angles, const PointQ& center, const Rational& rx, const Rational& ry) const;
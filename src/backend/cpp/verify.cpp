@@ -1,29 +1,81 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
 
-#include <tbb/parallel_invoke.h>
+#include <tbb/concurrent_hash_map.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
 
 #include "evaluator.hpp"
+#include "info_cache.hpp"
+#include "journal.hpp"
 #include "progress.hpp"
 #include "region.hpp"
 #include "verify.hpp"
 
+// Why a leaf was not covered, for the failure report
+struct EquationFailure final {
+    std::string reason;
+    std::string equation;
+    std::string margin;
+
+    // What failed in more detail, one item per line, for printing with the failed leaf when
+    // there is no failure report
+    std::string details;
+
+    // Whether to find and print the equation that fails, or only tell that one does. Finding
+    // it means checking the equations one at a time, which takes far longer.
+    bool explain = true;
+};
+
+template <typename T>
+static std::string to_string(const T& value) {
+    std::ostringstream oss{};
+    oss << value;
+    return oss.str();
+}
+
 template <template <typename> class Trig>
-bool equations_positive(const std::vector<std::tuple<EqVec<Trig>, Coeff64, Coeff64>>& eqs, const PointQ& center, const Rational& radius, Evaluator& eval) {
+bool equations_positive(const EquationArena<Trig>& eqs,
+                        const PointQ& center, const Rational& rx, const Rational& ry, Evaluator& eval,
+                        EquationFailure& failure) {
 
-    for (const auto& tup : eqs) {
+    for (size_t i = 0; i < eqs.size(); ++i) {
 
-        const auto& eq = std::get<0>(tup);
-        const auto bx = std::get<1>(tup);
-        const auto by = std::get<2>(tup);
+        const auto eq = eqs[i];
 
-        const auto pos = eval.is_positive(eq, bx + by, center, radius);
+        const auto pos = eval.is_positive(eq, center, rx, ry);
 
         if (!pos) {
-            std::cout << "Failure: not positive" << std::endl;
-            std::cout << "f(x, y) = " << eq << std::endl;
-            std::cout << "bound = " << (bx + by) << std::endl;
-            std::cout << "center = " << center << std::endl;
-            std::cout << "radius = " << radius << std::endl;
+            // How far off the first order test was, for seeing how much to subdivide
+            const auto margin = eval.margin(eq, center, rx, ry);
+
+            failure.reason = "not positive";
+            failure.equation = to_string(eq);
+            failure.margin = margin ? to_string(*margin) : "";
+
+            std::ostringstream oss{};
+            oss << "Failure: not positive\n"
+                << "f(x, y) = " << eq << '\n'
+                << "bx = " << eq.bx() << '\n'
+                << "by = " << eq.by() << '\n'
+                << "center = " << center << '\n'
+                << "rx = " << rx << '\n'
+                << "ry = " << ry << '\n';
+
+            if (margin) {
+                oss << "margin = " << *margin << '\n';
+            }
+
+            failure.details = oss.str();
+
             return false;
         }
     }
@@ -31,26 +83,38 @@ bool equations_positive(const std::vector<std::tuple<EqVec<Trig>, Coeff64, Coeff
     return true;
 }
 
+// The same as equations_positive, but only on the segment from center - (dx, dy) to center + (dx, dy)
 template <template <typename> class Trig>
-bool equations_positive(const std::vector<std::tuple<EqVec<Trig>, Coeff64, Coeff64>>& eqs,
-                        const PointQ& center, const Rational& rx, const Rational& ry, Evaluator& eval) {
+bool equations_positive_along(const EquationArena<Trig>& eqs,
+                              const PointQ& center, const Rational& dx, const Rational& dy, Evaluator& eval,
+                              EquationFailure& failure) {
 
-    for (const auto& tup : eqs) {
+    for (size_t i = 0; i < eqs.size(); ++i) {
 
-        const auto& eq = std::get<0>(tup);
-        const auto bx = std::get<1>(tup);
-        const auto by = std::get<2>(tup);
+        const auto eq = eqs[i];
 
-        const auto pos = eval.is_positive(eq, bx, by, center, rx, ry);
+        const auto pos = eval.is_positive_along(eq, center, dx, dy);
 
         if (!pos) {
-            std::cout << "Failure: not positive" << std::endl;
-            std::cout << "f(x, y) = " << eq << std::endl;
-            std::cout << "bx = " << bx << std::endl;
-            std::cout << "by = " << by << std::endl;
-            std::cout << "center = " << center << std::endl;
-            std::cout << "rx = " << rx << std::endl;
-            std::cout << "ry = " << ry << std::endl;
+            const auto margin = eval.margin_along(eq, center, dx, dy);
+
+            failure.reason = "not positive along segment";
+            failure.equation = to_string(eq);
+            failure.margin = margin ? to_string(*margin) : "";
+
+            std::ostringstream oss{};
+            oss << "Failure: not positive along segment\n"
+                << "f(x, y) = " << eq << '\n'
+                << "center = " << center << '\n'
+                << "dx = " << dx << '\n'
+                << "dy = " << dy << '\n';
+
+            if (margin) {
+                oss << "margin = " << *margin << '\n';
+            }
+
+            failure.details = oss.str();
+
             return false;
         }
     }
@@ -58,32 +122,131 @@ bool equations_positive(const std::vector<std::tuple<EqVec<Trig>, Coeff64, Coeff
     return true;
 }
 
-static bool covers_square(const StableInfo& info, const ClosedRectangleQ& square, const uint32_t bits) {
+// The number of equations proved positive at each precision, over the whole cover
+class PrecisionHistogram final {
+  private:
+    std::mutex mutex;
+    std::map<uint32_t, uint64_t> counts;
 
-    if (!geometry::subset(square, info.polygon)) {
-        std::cout << "Failure: square is not a subset of polygon" << std::endl;
+  public:
+    void add(const std::map<uint32_t, uint64_t>& histogram) {
+
+        const std::lock_guard<std::mutex> lock{mutex};
+
+        for (const auto& kv : histogram) {
+            counts[kv.first] += kv.second;
+        }
+    }
+
+    void print() const {
+
+        std::cout << "Precisions used:" << std::endl;
+
+        for (const auto& kv : counts) {
+            if (kv.first == 0) {
+                std::cout << "  double: " << kv.second << std::endl;
+            } else {
+                std::cout << "  " << kv.first << " bits: " << kv.second << std::endl;
+            }
+        }
+    }
+};
+
+template <typename Info>
+static void set_start_precision(const Info& info, const VerifyOptions& options, Evaluator& eval) {
+
+    if (options.estimate_precision) {
+        eval.set_start_precision(info.precision);
+    } else {
+        eval.set_start_precision(options.start_bits);
+    }
+}
+
+// The retired equations, if any, are skipped unless something fails
+template <typename Info>
+static bool info_positive(const Info& info, const PointQ& center, const Rational& rx, const Rational& ry,
+                          const VerifyOptions& options, Evaluator& eval, EquationFailure& failure,
+                          const RetiredEquations* const retired = nullptr) {
+
+    set_start_precision(info, options, eval);
+
+    // Share the trig terms between all the equations. Only if that fails do we go through
+    // them one at a time, to find the one that is not positive.
+    const auto all = retired != nullptr ? eval.all_positive(info, center, rx, ry, *retired)
+                                        : eval.all_positive(info, center, rx, ry);
+
+    if (all) {
+        return true;
+    }
+
+    if (!failure.explain) {
         return false;
     }
 
-    Evaluator eval{bits};
+    if (!equations_positive(info.sines, center, rx, ry, eval, failure)) {
+        failure.details += "not all sines positive\n";
+        return false;
+    }
 
-    const auto center = square.center();
-    // It's a square, so we can use width or height
-    const Rational radius = square.width() / 2;
+    if (!equations_positive(info.cosines, center, rx, ry, eval, failure)) {
+        failure.details += "not all cosines positive\n";
+        return false;
+    }
 
-    if (!equations_positive(info.sines, center, radius, eval)) {
-        std::cout << "not all sines positive" << std::endl;
+    return true;
+}
+
+template <typename Info>
+static bool info_positive_along(const Info& info, const PointQ& center, const Rational& dx, const Rational& dy,
+                                const VerifyOptions& options, Evaluator& eval, EquationFailure& failure) {
+
+    set_start_precision(info, options, eval);
+
+    if (eval.all_positive_along(info, center, dx, dy)) {
+        return true;
+    }
+
+    if (!failure.explain) {
         return false;
     }
 
-    if (!equations_positive(info.cosines, center, radius, eval)) {
-        std::cout << "not all cosines positive" << std::endl;
+    if (!equations_positive_along(info.sines, center, dx, dy, eval, failure)) {
+        failure.details += "not all sines positive\n";
+        return false;
+    }
+
+    if (!equations_positive_along(info.cosines, center, dx, dy, eval, failure)) {
+        failure.details += "not all cosines positive\n";
         return false;
     }
 
     return true;
 }
 
+static bool covers_square(const StableInfo& info, const ClosedRectangleQ& square, const uint32_t bits,
+                          const VerifyOptions& options, PrecisionHistogram& histogram, EquationFailure& failure,
+                          const RetiredEquations* const retired) {
+
+    if (!geometry::subset(square, info.polygon)) {
+        failure.reason = "square is not a subset of polygon";
+        failure.details = "Failure: square is not a subset of polygon\n";
+        return false;
+    }
+
+    auto& eval = thread_evaluator(bits);
+
+    const auto center = square.center();
+    // It's a square, so we can use width or height
+    const Rational radius = square.width() / 2;
+
+    const auto pos = info_positive(info, center, radius, radius, options, eval, failure, retired);
+
+    histogram.add(eval.precision_histogram());
+    eval.clear_precision_histogram();
+
+    return pos;
+}
+
 static PointQ find_intersection(const PointQ& corner0, const PointQ& corner1, const LinComArrZ<XYEta>& line) {
 
     // a*x + b*y + c = 0
@@ -176,14 +339,56 @@ static boost::optional<CenterRadius> find_center_radius(const std::vector<PointQ
     return CenterRadius{PointQ{std::move(cx), std::move(cy)}, std::move(rx), std::move(ry)};
 }
 
+// The segment from center - (dx, dy) to center + (dx, dy)
+struct CenterDirection final {
+
+    PointQ center;
+    Rational dx;
+    Rational dy;
+
+    explicit CenterDirection(PointQ center_, Rational dx_, Rational dy_)
+        : center{std::move(center_)},
+          dx{std::move(dx_)},
+          dy{std::move(dy_)} {}
+};
+
+// The segment between the (at most two) points where the line crosses the boundary of a square
+static boost::optional<CenterDirection> find_center_direction(const std::vector<PointQ>& zeros) {
+
+    if (zeros.empty()) {
+        return boost::none;
+    }
+
+    if (zeros.size() == 1) {
+        return CenterDirection{zeros.at(0), 0, 0};
+    }
+
+    if (zeros.size() != 2) {
+        std::ostringstream err{};
+        err << "find_center_direction: expected at most two zeros, got " << zeros.size();
+        throw std::runtime_error(err.str());
+    }
+
+    const auto& start = zeros.at(0);
+    const auto& end = zeros.at(1);
+
+    Rational dx = (end.x - start.x) / 2;
+    Rational dy = (end.y - start.y) / 2;
+
+    Rational cx = start.x + dx;
+    Rational cy = start.y + dy;
+
+    return CenterDirection{PointQ{std::move(cx), std::move(cy)}, std::move(dx), std::move(dy)};
+}
+
 struct TripleCenterRadius final {
 
     boost::optional<CenterRadius> stable_neg;
-    boost::optional<CenterRadius> unstable;
+    boost::optional<CenterDirection> unstable;
     boost::optional<CenterRadius> stable_pos;
 
     explicit TripleCenterRadius(boost::optional<CenterRadius> stable_neg_,
-                                boost::optional<CenterRadius> unstable_,
+                                boost::optional<CenterDirection> unstable_,
                                 boost::optional<CenterRadius> stable_pos_)
         : stable_neg{std::move(stable_neg_)},
           unstable{std::move(unstable_)},
@@ -328,71 +533,90 @@ triple_intersection(const TripleInfo& info, const LinComArrZ<XYEta>& line, const
     }
 
     auto stable_neg = find_center_radius(negatives, zeros);
-    auto unstable = find_center_radius(zeros, {});
+    // The unstable equations only need to hold on the line itself
+    auto unstable = find_center_direction(zeros);
     auto stable_pos = find_center_radius(positives, zeros);
 
     return TripleCenterRadius{std::move(stable_neg), std::move(unstable), std::move(stable_pos)};
 }
 
-static bool covers_square(const TripleInfo& info, const LinComArrZ<XYEta>& line, const ClosedRectangleQ& square, const uint32_t bits) {
+static bool covers_square(const TripleInfo& info, const LinComArrZ<XYEta>& line, const ClosedRectangleQ& square, const uint32_t bits,
+                          const VerifyOptions& options, PrecisionHistogram& histogram, EquationFailure& failure) {
 
     const auto geo = triple_intersection(info, line, square);
 
     if (!geo) {
+        failure.reason = "square does not fit the triple";
+        failure.details = "Failure: square does not fit the triple\n";
         return false;
     }
 
-    Evaluator eval{bits};
-
-    // Stable Neg
-    if (geo->stable_neg) {
+    auto& eval = thread_evaluator(bits);
 
-        const auto& cr = *geo->stable_neg;
+    // The reason says which of the three codes failed
+    const auto positive = [&](const auto& sub_info, const boost::optional<CenterRadius>& cr, const std::string& part) {
 
-        if (!equations_positive(info.stable_neg_info.sines, cr.center, cr.rx, cr.ry, eval)) {
-            std::cout << "not all sines positive" << std::endl;
-            return false;
+        if (!cr || info_positive(sub_info, cr->center, cr->rx, cr->ry, options, eval, failure)) {
+            return true;
         }
 
-        if (!equations_positive(info.stable_neg_info.cosines, cr.center, cr.rx, cr.ry, eval)) {
-            std::cout << "not all cosines positive" << std::endl;
-            return false;
-        }
-    }
+        failure.reason = part + ": " + failure.reason;
+        return false;
+    };
 
-    // Unstable
-    if (geo->unstable) {
+    const auto positive_along = [&]() {
 
-        const auto& cr = *geo->unstable;
+        const auto& unstable = geo->unstable;
 
-        if (!equations_positive(info.unstable_info.sines, cr.center, cr.rx, cr.ry, eval)) {
-            std::cout << "not all sines positive" << std::endl;
-            return false;
+        if (!unstable || info_positive_along(info.unstable_info, unstable->center, unstable->dx, unstable->dy, options, eval, failure)) {
+            return true;
         }
 
-        if (!equations_positive(info.unstable_info.cosines, cr.center, cr.rx, cr.ry, eval)) {
-            std::cout << "not all cosines positive" << std::endl;
-            return false;
-        }
-    }
+        failure.reason = "unstable: " + failure.reason;
+        return false;
+    };
 
-    // Stable Pos
-    if (geo->stable_pos) {
+    const auto pos = positive(info.stable_neg_info, geo->stable_neg, "stable_neg") &&
+                     positive_along() &&
+                     positive(info.stable_pos_info, geo->stable_pos, "stable_pos");
 
-        const auto& cr = *geo->stable_pos;
+    histogram.add(eval.precision_histogram());
+    eval.clear_precision_histogram();
 
-        if (!equations_positive(info.stable_pos_info.sines, cr.center, cr.rx, cr.ry, eval)) {
-            std::cout << "not all sines positive" << std::endl;
-            return false;
-        }
+    return pos;
+}
 
-        if (!equations_positive(info.stable_pos_info.cosines, cr.center, cr.rx, cr.ry, eval)) {
-            std::cout << "not all cosines positive" << std::endl;
-            return false;
-        }
-    }
+// Convert the givin amount of digits to a roughly equivalent amount of bits
+static uint32_t digits_to_bits(const uint32_t digits) {
+    // This is the function that boost uses, and so we'll keep it for now
 
-    return true;
+    // log2(10) ~ 1000/301
+
+    return (digits * 1000) / 301 + ((digits * 1000) % 301 ? 2 : 1);
+}
+
+bool single_covers_square(const StableInfo& info, const ClosedRectangleQ& square, const uint32_t digits,
+                          const VerifyOptions& options) {
+
+    PrecisionHistogram histogram{};
+
+    EquationFailure failure{};
+    failure.explain = false;
+
+    return covers_square(info, square, digits_to_bits(digits), options, histogram, failure, nullptr);
+}
+
+bool triple_covers_square(const TripleInfo& info, const TriplePair& triple_pair, const ClosedRectangleQ& square,
+                          const uint32_t digits, const VerifyOptions& options) {
+
+    PrecisionHistogram histogram{};
+
+    EquationFailure failure{};
+    failure.explain = false;
+
+    const auto line = triple_pair.unstable.sequence.constraint(triple_pair.unstable.angles);
+
+    return covers_square(info, line, square, digits_to_bits(digits), options, histogram, failure);
 }
 
 struct CountLeaves final : public boost::static_visitor<uint64_t> {
@@ -420,118 +644,792 @@ struct CountLeaves final : public boost::static_visitor<uint64_t> {
     }
 };
 
+uint64_t count_leaves(const cover::Cover& cover) {
+    return boost::apply_visitor(CountLeaves{}, cover);
+}
+
+// Counts the leaves that use each single and triple, in the subtrees that are not completed
+class CountCodeUses final : public boost::static_visitor<void> {
+
+  private:
+    const std::string& path;
+    const std::set<std::string>& completed;
+    CodeUses& uses;
+
+  public:
+    explicit CountCodeUses(const std::string& path_,
+                           const std::set<std::string>& completed_,
+                           CodeUses& uses_)
+        : path{path_},
+          completed{completed_},
+          uses{uses_} {}
+
+    void operator()(const cover::Empty) const {}
+
+    void operator()(const cover::Single& single) const {
+        ++uses.singles[single.index];
+    }
+
+    void operator()(const cover::Triple& triple) const {
+        ++uses.triples[triple.index];
+    }
+
+    void operator()(const cover::Divide& divide) const {
+
+        const auto& quarter_covers = divide.quarters.get();
+
+        for (size_t i = 0; i < 4; ++i) {
+
+            const auto quarter_path = path + static_cast<char>('0' + i);
+
+            if (completed.count(quarter_path) == 0) {
+                const CountCodeUses count{quarter_path, completed, uses};
+                boost::apply_visitor(count, quarter_covers.at(i));
+            }
+        }
+    }
+};
+
+// The subtrees that verify_cover leaves out, because they are completed or in another shard
+static std::set<std::string> skipped_paths(const VerifyOptions& options) {
+
+    auto paths = options.completed;
+    paths.insert(std::begin(options.excluded), std::end(options.excluded));
+
+    return paths;
+}
+
+// The subtree of the cover at a path, see Journal
+static const cover::Cover& subtree(const cover::Cover& cover, const std::string& path) {
+
+    const auto* node = &cover;
+
+    for (const auto digit : path) {
+
+        const auto* divide = boost::get<cover::Divide>(node);
+
+        if (divide == nullptr || digit < '0' || digit > '3') {
+            std::ostringstream err{};
+            err << "subtree: path " << path << " is not in the cover";
+            throw std::runtime_error(err.str());
+        }
+
+        node = &divide->quarters.get().at(static_cast<size_t>(digit - '0'));
+    }
+
+    return *node;
+}
+
+CodeUses count_code_uses(const cover::Cover& cover, const VerifyOptions& options, const std::string& path) {
+
+    CodeUses uses{};
+
+    const auto skipped = skipped_paths(options);
+
+    if (skipped.count(path) == 0) {
+        const CountCodeUses count{path, skipped, uses};
+        boost::apply_visitor(count, subtree(cover, path));
+    }
+
+    return uses;
+}
+
+// A leaf of the cover that was not covered, see write_failure_report
+struct LeafFailure final {
+    std::string path;
+    std::string square;
+    std::string kind;
+    boost::optional<size_t> index;
+    EquationFailure failure;
+};
+
+// What the tasks checking the cover share
+struct VerifyState final {
+
+    // Set once any leaf fails with options.fail_fast, after which nothing more is checked
+    std::atomic<bool> cancelled{false};
+
+    // How many equations were proven over the square of a Divide instead of at its leaves
+    std::atomic<uint64_t> retired{0};
+
+    // How many leaves were checked, whether or not they were covered
+    std::atomic<uint64_t> checked{0};
+
+    // The subtrees that are not checked, see skipped_paths
+    std::set<std::string> skipped;
+
+    // The equations retired over the square of each Divide above the work items, by path.
+    // The first item below a Divide works them out, and every other one reuses them.
+    tbb::concurrent_hash_map<std::string, std::map<size_t, RetiredEquations>> retired_above{};
+
+    // Each thread records its failures separately, so they need no locking and don't get
+    // interleaved. Only used with options.report_file.
+    tbb::enumerable_thread_specific<std::vector<LeafFailure>> failures{};
+};
+
+// The single codes of a subtree, as long as there are at most max of them. Returns whether
+// there were. The skipped subtrees are left out, since their codes may not be in the cache.
+class CollectSingles final : public boost::static_visitor<bool> {
+
+  private:
+    std::set<size_t>& singles;
+    const size_t max;
+    const std::string path;
+    const std::set<std::string>& skipped;
+
+  public:
+    explicit CollectSingles(std::set<size_t>& singles_, const size_t max_,
+                            std::string path_, const std::set<std::string>& skipped_)
+        : singles{singles_},
+          max{max_},
+          path{std::move(path_)},
+          skipped{skipped_} {}
+
+    bool operator()(const cover::Empty) const {
+        return true;
+    }
+
+    bool operator()(const cover::Single& single) const {
+        singles.insert(single.index);
+        return singles.size() <= max;
+    }
+
+    bool operator()(const cover::Triple&) const {
+        return true;
+    }
+
+    bool operator()(const cover::Divide& divide) const {
+
+        const auto& quarter_covers = divide.quarters.get();
+
+        for (size_t i = 0; i < 4; ++i) {
+
+            const auto quarter_path = path + static_cast<char>('0' + i);
+
+            if (skipped.count(quarter_path) != 0) {
+                continue;
+            }
+
+            const CollectSingles collect{singles, max, quarter_path, skipped};
+
+            if (!boost::apply_visitor(collect, quarter_covers.at(i))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+// Retiring the equations of a code over the square of a Divide costs about as much as
+// checking one leaf, so it only pays off when every code covers a lot of leaves below it
+constexpr size_t max_retired_codes = 4;
+
+// Retire the equations of the single codes below the Divide at path that are positive over
+// its whole square, on top of the ones that already are. Deep subtrees covered by a few codes
+// then only prove most of their equations once, instead of at every leaf.
+static std::map<size_t, RetiredEquations> retire_equations(const cover::Divide& divide,
+                                                           const ClosedRectangleQ& square,
+                                                           const std::string& path,
+                                                           const std::map<size_t, RetiredEquations>& retired,
+                                                           InfoCache& infos,
+                                                           const uint32_t bits,
+                                                           VerifyState& state) {
+
+    std::set<size_t> codes{};
+
+    if (!CollectSingles{codes, max_retired_codes, path, state.skipped}(divide)) {
+        return retired;
+    }
+
+    auto retired_below = retired;
+
+    auto& eval = thread_evaluator(bits);
+
+    const auto center = square.center();
+    const Rational radius = square.width() / 2;
+
+    for (const auto index : codes) {
+
+        // The leaves below have not released the code yet, so it is still in the cache.
+        // This is not a use of its own, so it is not released either.
+        const auto info = infos.acquire_single(index);
+
+        state.retired += eval.retire_positive(*info, center, radius, radius, retired_below[index]);
+    }
+
+    return retired_below;
+}
+
 class CoverVerifier final : public boost::static_visitor<bool> {
 
   private:
     const ClosedRectangleQ& square;
     const OpenConvexPolygonQ& polygon;
-    const std::map<size_t, std::pair<CodePair, StableInfo>>& single_infos;
-    const std::map<size_t, std::pair<TriplePair, TripleInfo>>& triple_infos;
+    InfoCache& infos;
     const uint32_t bits;
+    const VerifyOptions& options;
+    PrecisionHistogram& histogram;
     Progress& progress;
 
+    // The path to the square, see Journal
+    const std::string path;
+
+    // The equations of single codes that are already proven over a square containing this one
+    const std::map<size_t, RetiredEquations>& retired;
+
+    VerifyState& state;
+
+    bool finish_leaf(const bool covered, const std::string& kind, const boost::optional<size_t> index, EquationFailure failure) const {
+
+        ++progress;
+        ++state.checked;
+
+        if (!covered) {
+            // Other threads print too, so the whole message goes out in one write. With a
+            // report, the details go in there instead.
+            std::ostringstream oss{};
+            oss << "Failed leaf " << (path.empty() ? "(root)" : path) << ": " << square << '\n';
+
+            if (options.report_file.empty()) {
+                oss << failure.details;
+            } else {
+                state.failures.local().push_back(LeafFailure{path, to_string(square), kind, index, std::move(failure)});
+            }
+
+            std::cout << oss.str() << std::flush;
+
+            if (options.fail_fast) {
+                state.cancelled = true;
+            }
+        }
+
+        return covered;
+    }
+
   public:
     explicit CoverVerifier(const ClosedRectangleQ& square_, const OpenConvexPolygonQ& polygon_,
-                           const std::map<size_t, std::pair<CodePair, StableInfo>>& single_infos_,
-                           const std::map<size_t, std::pair<TriplePair, TripleInfo>>& triple_infos_,
+                           InfoCache& infos_,
                            const uint32_t bits_,
-                           Progress& progress_)
+                           const VerifyOptions& options_,
+                           PrecisionHistogram& histogram_,
+                           Progress& progress_,
+                           std::string path_,
+                           const std::map<size_t, RetiredEquations>& retired_,
+                           VerifyState& state_)
         : square{square_},
           polygon{polygon_},
-          single_infos{single_infos_},
-          triple_infos{triple_infos_},
+          infos{infos_},
           bits{bits_},
-          progress{progress_} {}
+          options{options_},
+          histogram{histogram_},
+          progress{progress_},
+          path{std::move(path_)},
+          retired{retired_},
+          state{state_} {}
 
     bool operator()(const cover::Empty) const {
 
         const auto inter = geometry::intersects(square, polygon);
 
-        if (inter) {
-            std::cout << "Failure: empty square intersects polygon" << std::endl;
-        }
+        EquationFailure failure{};
+        failure.reason = "empty square intersects polygon";
+        failure.details = "Failure: empty square intersects polygon\n";
 
-        ++progress;
-
-        return !inter;
+        return finish_leaf(!inter, "empty", boost::none, std::move(failure));
     }
 
     bool operator()(const cover::Single& single) const {
 
-        const auto& stable_info = single_infos.at(single.index).second;
+        const auto stable_info = infos.acquire_single(single.index);
 
-        const auto cover = covers_square(stable_info, square, bits);
+        EquationFailure failure{};
 
-        ++progress;
+        const auto found = retired.find(single.index);
+        const auto* const retired_equations = found != std::end(retired) ? &found->second : nullptr;
+
+        const auto cover = covers_square(*stable_info, square, bits, options, histogram, failure, retired_equations);
 
-        return cover;
+        infos.release_single(single.index);
+
+        return finish_leaf(cover, "single", single.index, std::move(failure));
     }
 
     bool operator()(const cover::Triple& triple) const {
 
-        const auto& triple_pair = triple_infos.at(triple.index).first;
-        const auto& triple_info = triple_infos.at(triple.index).second;
+        const auto& triple_pair = infos.triples().at(triple.index);
+        const auto triple_info = infos.acquire_triple(triple.index);
 
         const auto line = triple_pair.unstable.sequence.constraint(triple_pair.unstable.angles);
 
-        const auto cover = covers_square(triple_info, line, square, bits);
+        EquationFailure failure{};
 
-        ++progress;
+        const auto cover = covers_square(*triple_info, line, square, bits, options, histogram, failure);
+
+        infos.release_triple(triple.index);
 
-        return cover;
+        return finish_leaf(cover, "triple", triple.index, std::move(failure));
     }
 
+    // The parallelism comes from verify_cover scheduling whole subtrees, so this is sequential
     bool operator()(const cover::Divide& divide) const {
 
         const auto quarter_squares = subdivide(square);
         const auto& quarter_covers = divide.quarters.get();
 
-        // These values get overwritten, so just initialize them to false
-        bool covered0 = false;
-        bool covered1 = false;
-        bool covered2 = false;
-        bool covered3 = false;
+        const auto retired_below = retire_equations(divide, square, path, retired, infos, bits, state);
+
+        // Check every quarter, even after a failure, so that all of the failures get printed,
+        // unless we are failing fast
+        bool covered = true;
+
+        for (size_t i = 0; i < quarter_squares.size(); ++i) {
+
+            // A cancelled subtree was not fully checked, so it must not count as covered
+            if (state.cancelled) {
+                return false;
+            }
+
+            const CoverVerifier verifier{quarter_squares.at(i), polygon, infos, bits, options, histogram, progress,
+                                         path + static_cast<char>('0' + i), retired_below, state};
+            covered = boost::apply_visitor(verifier, quarter_covers.at(i)) && covered;
+        }
+
+        return covered;
+    }
+};
+
+// A rough estimate of how long it takes to check the equations of a code, in arbitrary units.
+// The infos are only calculated once a leaf needs them, so this can't look at the equations.
+// Both how many there are and how many terms they have grow with the length of the
+// unfolding, which is the sum of the code numbers.
+static uint64_t code_cost(const CodePair& code_pair) {
+    return 1 + static_cast<uint64_t>(code_pair.sequence.sum());
+}
+
+// A subtree of the cover that is checked by a single task, from start to finish
+struct WorkItem final {
+
+    ClosedRectangleQ square;
+    const cover::Cover* cover;
+    uint64_t leaves;
+    uint64_t cost;
+
+    // The path to the subtree, see Journal
+    std::string path;
+
+    explicit WorkItem(ClosedRectangleQ square_, const cover::Cover& cover_, const uint64_t leaves_, const uint64_t cost_, std::string path_)
+        : square{std::move(square_)},
+          cover{&cover_},
+          leaves{leaves_},
+          cost{cost_},
+          path{std::move(path_)} {}
+};
+
+struct SubtreeCost final {
+    uint64_t leaves;
+    uint64_t cost;
+
+    // Whether the subtree has already been split up into work items
+    bool scheduled;
+};
+
+// Work items with at most this many leaves are checked by a single task
+constexpr uint64_t sequential_cutoff = 32;
+
+// Splits a cover into work items. Any subtree with at most cutoff leaves is kept whole, since
+// splitting it further would cost more in scheduling than it gains in balance. Subtrees that
+// an earlier run has completed are left out, and their leaves are added to skipped.
+class CollectWork final : public boost::static_visitor<SubtreeCost> {
+
+  private:
+    const uint64_t cutoff;
+    const ClosedRectangleQ& square;
+    const std::string& path;
+    const std::vector<uint64_t>& single_costs;
+    const std::vector<uint64_t>& triple_costs;
+    const std::set<std::string>& completed;
+    std::vector<WorkItem>& items;
+    uint64_t& skipped;
+
+  public:
+    explicit CollectWork(const uint64_t cutoff_,
+                         const ClosedRectangleQ& square_,
+                         const std::string& path_,
+                         const std::vector<uint64_t>& single_costs_,
+                         const std::vector<uint64_t>& triple_costs_,
+                         const std::set<std::string>& completed_,
+                         std::vector<WorkItem>& items_,
+                         uint64_t& skipped_)
+        : cutoff{cutoff_},
+          square{square_},
+          path{path_},
+          single_costs{single_costs_},
+          triple_costs{triple_costs_},
+          completed{completed_},
+          items{items_},
+          skipped{skipped_} {}
+
+    SubtreeCost operator()(const cover::Empty) const {
+        return SubtreeCost{1, 1, false};
+    }
+
+    SubtreeCost operator()(const cover::Single& single) const {
+        return SubtreeCost{1, single_costs.at(single.index), false};
+    }
+
+    SubtreeCost operator()(const cover::Triple& triple) const {
+        return SubtreeCost{1, triple_costs.at(triple.index), false};
+    }
+
+    SubtreeCost operator()(const cover::Divide& divide) const {
+
+        const auto quarter_squares = subdivide(square);
+        const auto& quarter_covers = divide.quarters.get();
+
+        std::array<SubtreeCost, 4> quarters{};
+
+        SubtreeCost total{0, 0, false};
+
+        for (size_t i = 0; i < quarters.size(); ++i) {
 
-        const auto l0 = [&] {
-            const CoverVerifier verifier{std::get<0>(quarter_squares), polygon, single_infos, triple_infos, bits, progress};
-            covered0 = boost::apply_visitor(verifier, quarter_covers.get<0>());
-        };
+            const auto quarter_path = path + static_cast<char>('0' + i);
 
-        const auto l1 = [&] {
-            const CoverVerifier verifier{std::get<1>(quarter_squares), polygon, single_infos, triple_infos, bits, progress};
-            covered1 = boost::apply_visitor(verifier, quarter_covers.get<1>());
-        };
+            if (completed.count(quarter_path) != 0) {
 
-        const auto l2 = [&] {
-            const CoverVerifier verifier{std::get<2>(quarter_squares), polygon, single_infos, triple_infos, bits, progress};
-            covered2 = boost::apply_visitor(verifier, quarter_covers.get<2>());
-        };
+                const auto leaves = count_leaves(quarter_covers.at(i));
+                skipped += leaves;
 
-        const auto l3 = [&] {
-            const CoverVerifier verifier{std::get<3>(quarter_squares), polygon, single_infos, triple_infos, bits, progress};
-            covered3 = boost::apply_visitor(verifier, quarter_covers.get<3>());
-        };
+                // There is nothing left to schedule
+                quarters.at(i) = SubtreeCost{leaves, 0, true};
 
-        tbb::parallel_invoke(l0, l1, l2, l3);
+            } else {
+                const CollectWork collect{cutoff, quarter_squares.at(i), quarter_path, single_costs, triple_costs, completed, items, skipped};
+                quarters.at(i) = boost::apply_visitor(collect, quarter_covers.at(i));
+            }
+
+            total.leaves += quarters.at(i).leaves;
+            total.cost += quarters.at(i).cost;
+            total.scheduled = total.scheduled || quarters.at(i).scheduled;
+        }
 
-        return covered0 && covered1 && covered2 && covered3;
+        if (!total.scheduled && total.leaves <= cutoff) {
+            return total;
+        }
+
+        // This subtree is too large to keep whole, so each quarter that is not already
+        // split up becomes its own work item
+        for (size_t i = 0; i < quarters.size(); ++i) {
+            if (!quarters.at(i).scheduled) {
+                items.emplace_back(quarter_squares.at(i), quarter_covers.at(i), quarters.at(i).leaves, quarters.at(i).cost,
+                                   path + static_cast<char>('0' + i));
+            }
+        }
+
+        total.scheduled = true;
+
+        return total;
     }
 };
 
-// Convert the givin amount of digits to a roughly equivalent amount of bits
-static uint32_t digits_to_bits(const uint32_t digits) {
-    // This is the function that boost uses, and so we'll keep it for now
+// Split the cover into work items of at most cutoff leaves, in no particular order
+static std::vector<WorkItem> schedule_cover(const uint64_t cutoff,
+                                            const ClosedRectangleQ& square,
+                                            const std::vector<CodePair>& singles,
+                                            const std::vector<TriplePair>& triples,
+                                            const cover::Cover& cover,
+                                            const std::string& root_path,
+                                            const std::set<std::string>& completed,
+                                            uint64_t& skipped) {
+
+    std::vector<uint64_t> single_costs{};
+
+    for (const auto& single : singles) {
+        // Plus checking that the square is inside the polygon
+        single_costs.push_back(1 + code_cost(single));
+    }
 
-    // log2(10) ~ 1000/301
+    std::vector<uint64_t> triple_costs{};
 
-    return (digits * 1000) / 301 + ((digits * 1000) % 301 ? 2 : 1);
+    for (const auto& triple : triples) {
+        // Plus finding where the line crosses the square
+        triple_costs.push_back(4 + code_cost(triple.stable_neg) +
+                                   code_cost(triple.unstable) +
+                                   code_cost(triple.stable_pos));
+    }
+
+    std::vector<WorkItem> items{};
+
+    if (completed.count(root_path) != 0) {
+        skipped += count_leaves(cover);
+        return items;
+    }
+
+    const CollectWork collect{cutoff, square, root_path, single_costs, triple_costs, completed, items, skipped};
+    const auto root = boost::apply_visitor(collect, cover);
+
+    if (!root.scheduled) {
+        items.emplace_back(square, cover, root.leaves, root.cost, root_path);
+    }
+
+    return items;
+}
+
+// Sort the items from the most to the least expensive, ties by path so the order is the same
+// in every process
+static void sort_by_cost(std::vector<WorkItem>& items) {
+
+    std::sort(std::begin(items), std::end(items), [](const WorkItem& lhs, const WorkItem& rhs) {
+        return lhs.cost > rhs.cost || (lhs.cost == rhs.cost && lhs.path < rhs.path);
+    });
+}
+
+// How many levels below the root of a check make up a region, see sort_by_region
+constexpr size_t region_depth = 2;
+
+// Sort the items region by region, and from the most to the least expensive within each
+// region. A code is loaded at its first leaf and freed after its last, so sorting by cost
+// alone would spread the leaves of each code over the whole run, and keep nearly every code
+// in memory at once. This way only the codes of the regions being checked are, and the long
+// items of the last region still start before its short ones.
+static void sort_by_region(std::vector<WorkItem>& items, const std::string& root_path) {
+
+    const auto region = [&](const WorkItem& item) {
+        return item.path.substr(0, root_path.size() + region_depth);
+    };
+
+    std::sort(std::begin(items), std::end(items), [&](const WorkItem& lhs, const WorkItem& rhs) {
+
+        const auto lhs_region = region(lhs);
+        const auto rhs_region = region(rhs);
+
+        if (lhs_region != rhs_region) {
+            return lhs_region < rhs_region;
+        }
+
+        return lhs.cost > rhs.cost || (lhs.cost == rhs.cost && lhs.path < rhs.path);
+    });
+}
+
+std::vector<std::string> plan_work(const ClosedRectangleQ& square,
+                                   const std::vector<CodePair>& singles,
+                                   const std::vector<TriplePair>& triples,
+                                   const cover::Cover& cover,
+                                   const uint64_t max_leaves) {
+
+    uint64_t skipped = 0;
+    auto items = schedule_cover(max_leaves, square, singles, triples, cover, "", {}, skipped);
+
+    sort_by_cost(items);
+
+    std::vector<std::string> paths{};
+
+    for (const auto& item : items) {
+        paths.push_back(item.path);
+    }
+
+    return paths;
+}
+
+std::vector<ShardPlan> plan_shards(const ClosedRectangleQ& square,
+                                   const std::vector<CodePair>& singles,
+                                   const std::vector<TriplePair>& triples,
+                                   const cover::Cover& cover,
+                                   const size_t count) {
+
+    if (count == 0) {
+        throw std::runtime_error("plan_shards: need at least one shard");
+    }
+
+    // The same as an unsharded run, so the shards don't depend on what has been resumed
+    uint64_t skipped = 0;
+    auto items = schedule_cover(sequential_cutoff, square, singles, triples, cover, "", {}, skipped);
+
+    sort_by_cost(items);
+
+    std::vector<ShardPlan> shards(count);
+
+    // The items come most expensive first, and each goes to the cheapest shard so far. Ties
+    // go to the lowest shard, so every process comes up with the same plan.
+    for (const auto& item : items) {
+
+        const auto cheapest = std::min_element(std::begin(shards), std::end(shards), [](const ShardPlan& lhs, const ShardPlan& rhs) {
+            return lhs.cost < rhs.cost;
+        });
+
+        cheapest->paths.insert(item.path);
+        cheapest->leaves += item.leaves;
+        cheapest->cost += item.cost;
+    }
+
+    return shards;
+}
+
+std::set<std::string> other_shards(const std::vector<ShardPlan>& shards, const size_t index) {
+
+    std::set<std::string> paths{};
+
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (i != index) {
+            paths.insert(std::begin(shards.at(i).paths), std::end(shards.at(i).paths));
+        }
+    }
+
+    return paths;
+}
+
+static std::string report_field(const std::string& field) {
+    return field.empty() ? "-" : field;
+}
+
+// Writes every failure, one per line, as tab separated path, square, kind, index, reason,
+// equation and margin, with "-" for the ones that don't apply. The lines are sorted by path,
+// so neighbouring squares are together and the report is the same from run to run.
+static void write_failure_report(const std::string& file, const VerifyState& state) {
+
+    std::vector<LeafFailure> failures{};
+
+    for (const auto& local : state.failures) {
+        failures.insert(failures.end(), local.begin(), local.end());
+    }
+
+    std::sort(failures.begin(), failures.end(), [](const LeafFailure& lhs, const LeafFailure& rhs) {
+        return lhs.path < rhs.path;
+    });
+
+    std::ofstream output{file};
+
+    if (!output) {
+        std::ostringstream err{};
+        err << "write_failure_report: could not open " << file;
+        throw std::runtime_error(err.str());
+    }
+
+    output << "# path\tsquare\tkind\tindex\treason\tequation\tmargin\n";
+
+    for (const auto& failure : failures) {
+        output << (failure.path.empty() ? "root" : failure.path) << '\t'
+               << failure.square << '\t'
+               << failure.kind << '\t'
+               << (failure.index ? std::to_string(*failure.index) : "-") << '\t'
+               << report_field(failure.failure.reason) << '\t'
+               << report_field(failure.failure.equation) << '\t'
+               << report_field(failure.failure.margin) << '\n';
+    }
+
+    output.flush();
+
+    if (!output) {
+        std::ostringstream err{};
+        err << "write_failure_report: could not write " << file;
+        throw std::runtime_error(err.str());
+    }
+
+    std::cout << "Wrote " << failures.size() << " failures to " << file << std::endl;
+}
+
+// The equations retired over every Divide above the work item, from the root of the check at
+// root_path down. These only depend on the cover, so each Divide works them out once, for
+// whichever item below it starts first, and before any leaf below it is checked.
+static std::map<size_t, RetiredEquations> retired_above(const WorkItem& item,
+                                                        const ClosedRectangleQ& root_square,
+                                                        const cover::Cover& root_cover,
+                                                        const std::string& root_path,
+                                                        InfoCache& infos,
+                                                        const uint32_t bits,
+                                                        VerifyState& state) {
+
+    std::map<size_t, RetiredEquations> retired{};
+
+    auto square = root_square;
+    const auto* node = &root_cover;
+
+    for (auto length = root_path.size(); length < item.path.size(); ++length) {
+
+        const auto& divide = boost::get<cover::Divide>(*node);
+        const auto path = item.path.substr(0, length);
+
+        {
+            // Anyone else after the same Divide waits until it is done
+            decltype(state.retired_above)::accessor accessor{};
+
+            if (state.retired_above.insert(accessor, path)) {
+                accessor->second = retire_equations(divide, square, path, retired, infos, bits, state);
+            }
+
+            retired = accessor->second;
+        }
+
+        const auto index = static_cast<size_t>(item.path.at(length) - '0');
+
+        square = subdivide(square).at(index);
+        node = &divide.quarters.get().at(index);
+    }
+
+    return retired;
+}
+
+// Checks the work items of the subtree at root_path in parallel, in the order they are given,
+// and records the ones that are covered in the journal, if there is one
+static bool check_items(const std::vector<WorkItem>& items,
+                        const ClosedRectangleQ& root_square,
+                        const cover::Cover& root_cover,
+                        const std::string& root_path,
+                        const OpenConvexPolygonQ& polygon,
+                        InfoCache& infos,
+                        const uint32_t bits,
+                        const VerifyOptions& options,
+                        PrecisionHistogram& histogram,
+                        VerifyState& state,
+                        Progress& progress,
+                        Journal* const journal) {
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> all_covered{true};
+
+    // Each worker takes the next item, which within a region is the most expensive one left,
+    // so the long ones start first and the short ones fill in the gaps
+    const auto worker = [&] {
+        for (auto i = next++; i < items.size() && !state.cancelled; i = next++) {
+
+            const auto& item = items.at(i);
+
+            const auto retired = retired_above(item, root_square, root_cover, root_path, infos, bits, state);
+
+            const CoverVerifier verifier{item.square, polygon, infos, bits, options, histogram, progress,
+                                         item.path, retired, state};
+
+            if (!boost::apply_visitor(verifier, *item.cover)) {
+                all_covered = false;
+            } else if (journal != nullptr) {
+                journal->record(item.path);
+            }
+        }
+    };
+
+    tbb::task_group group{};
+
+    const auto workers = std::min<size_t>(static_cast<size_t>(tbb::this_task_arena::max_concurrency()), items.size());
+
+    for (size_t i = 0; i < workers; ++i) {
+        group.run(worker);
+    }
+
+    group.wait();
+
+    if (state.cancelled) {
+        progress.stop();
+    }
+
+    return all_covered;
 }
 
 bool verify_cover(const ClosedRectangleQ& square, const OpenConvexPolygonQ& polygon,
-                  const std::map<size_t, std::pair<CodePair, StableInfo>>& single_infos,
-                  const std::map<size_t, std::pair<TriplePair, TripleInfo>>& triple_infos,
+                  InfoCache& infos,
                   const cover::Cover& cover,
-                  const uint32_t digits) {
+                  const uint32_t digits,
+                  const VerifyOptions& options,
+                  VerifyStats& stats) {
 
     if (!geometry::subset(polygon, square)) {
         std::cout << "Error: the polygon is not a subset of the cover square" << std::endl;
@@ -540,13 +1438,121 @@ bool verify_cover(const ClosedRectangleQ& square, const OpenConvexPolygonQ& poly
 
     const auto bits = digits_to_bits(digits);
 
-    const auto leaves = boost::apply_visitor(CountLeaves{}, cover);
+    const auto leaves = count_leaves(cover);
+
+    PrecisionHistogram histogram{};
+    VerifyState state{};
+    state.skipped = skipped_paths(options);
+
+    bool covered = false;
+
+    uint64_t excluded = 0;
+
+    for (const auto& path : options.excluded) {
+        excluded += count_leaves(subtree(cover, path));
+    }
+
+    if (excluded != 0) {
+        std::cout << "Sharding: " << excluded << " of " << leaves << " leaves are in other shards" << std::endl;
+    }
+
+    uint64_t skipped = 0;
+
+    auto items = schedule_cover(sequential_cutoff, square, infos.singles(), infos.triples(), cover, "", state.skipped, skipped);
+
+    sort_by_region(items, "");
+
+    if (skipped > excluded) {
+        std::cout << "Resuming: " << skipped - excluded << " of " << leaves - excluded << " leaves were already verified" << std::endl;
+    }
+
+    // Only append to the journal if we are continuing from it
+    std::unique_ptr<Journal> journal{};
 
-    Progress progress{"Checking cover: ", leaves};
+    if (!options.journal_file.empty()) {
+        journal.reset(new Journal{options.journal_file, options.digest, !options.completed.empty()});
+    }
+
+    {
+        Progress progress{"Checking cover: ", leaves - skipped};
+
+        covered = check_items(items, square, cover, "", polygon, infos, bits, options, histogram, state, progress, journal.get());
+    }
+
+    if (!covered && options.fail_fast) {
+        std::cout << "Stopped checking the cover after the first failure" << std::endl;
+    }
+
+    if (!options.report_file.empty()) {
+        write_failure_report(options.report_file, state);
+    }
+
+    if (journal) {
+        journal->flush();
+    }
+
+    // Wait for the progress bar to finish before printing this
+    histogram.print();
 
-    const CoverVerifier verifier{square, polygon, single_infos, triple_infos, bits, progress};
+    std::cout << "Most code infos in memory at once: " << infos.peak() << std::endl;
+    std::cout << "Equations retired over divided squares: " << state.retired << std::endl;
 
-    const auto covered = boost::apply_visitor(verifier, cover);
+    stats.checked = state.checked;
+    stats.resumed = skipped - excluded;
 
     return covered;
 }
+
+bool verify_subtree(const ClosedRectangleQ& square, const OpenConvexPolygonQ& polygon,
+                    InfoCache& infos,
+                    const cover::Cover& cover,
+                    const std::string& path,
+                    const uint32_t digits,
+                    const VerifyOptions& options) {
+
+    const auto bits = digits_to_bits(digits);
+
+    const auto& sub_cover = subtree(cover, path);
+
+    auto sub_square = square;
+
+    for (const auto digit : path) {
+        sub_square = subdivide(sub_square).at(static_cast<size_t>(digit - '0'));
+    }
+
+    PrecisionHistogram histogram{};
+    VerifyState state{};
+    state.skipped = skipped_paths(options);
+
+    uint64_t skipped = 0;
+
+    auto items = schedule_cover(sequential_cutoff, sub_square, infos.singles(), infos.triples(), sub_cover, path, state.skipped, skipped);
+
+    sort_by_region(items, path);
+
+    Progress progress{"Checking " + (path.empty() ? std::string{"cover"} : path) + ": ", count_leaves(sub_cover) - skipped};
+
+    return check_items(items, sub_square, sub_cover, path, polygon, infos, bits, options, histogram, state, progress, nullptr);
+}
+
+SubtreeVerifier::SubtreeVerifier(const ClosedRectangleQ& square_, const OpenConvexPolygonQ& polygon_,
+                                 const std::vector<CodePair>& singles,
+                                 const std::vector<TriplePair>& triples,
+                                 const cover::Cover& cover_,
+                                 const uint32_t digits_,
+                                 const VerifyOptions& options_,
+                                 const InfoStore* const store)
+    : square{square_},
+      polygon{polygon_},
+      cover{cover_},
+      digits{digits_},
+      options{options_},
+      infos{singles, triples, CodeUses{}, store} {}
+
+bool SubtreeVerifier::operator()(const std::string& path) {
+
+    // The leaves of the subtree release these as they go
+    infos.add_uses(count_code_uses(cover, options, path));
+
+    return verify_subtree(square, polygon, infos, cover, path, digits, options);
+}
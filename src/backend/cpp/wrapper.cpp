@@ -1,10 +1,23 @@
 #include <iostream>
+#include <memory>
+#include <mutex>
 
 #include "check.hpp"
 #include "equations.hpp"
+#include "info_store.hpp"
 #include "parse.hpp"
 #include "wrapper.hpp"
 
+// The store from open_info_store. The viewer may call us from several threads, and each call
+// keeps the store it started with alive until it is done.
+static std::mutex store_mutex{};
+static std::shared_ptr<const InfoStore> info_store{};
+
+static std::shared_ptr<const InfoStore> current_store() {
+    const std::lock_guard<std::mutex> lock{store_mutex};
+    return info_store;
+}
+
 static std::string serialize(const std::vector<PointQ>& points) {
 
     std::ostringstream oss{};
@@ -80,6 +93,22 @@ static void copy_to_c_code_info(const CodeInfo& code_info, CCodeInfo* const c_co
     c_code_info->cos_equations = to_cstr(serialize(code_info.cos_equations));
 }
 
+int32_t open_info_store(const char* const file) {
+
+    std::shared_ptr<const InfoStore> store{};
+
+    try {
+        store = load_info_store(file);
+    } catch (const std::exception& except) {
+        std::cerr << except.what() << std::endl;
+    }
+
+    const std::lock_guard<std::mutex> lock{store_mutex};
+    info_store = store;
+
+    return store ? 1 : 0;
+}
+
 // 0 means failure
 // 1 means success
 int32_t load_code_info(const char* const code_sequence_ptr,
@@ -90,9 +119,21 @@ int32_t load_code_info(const char* const code_sequence_ptr,
         const auto code_sequence = parse_code_sequence(code_sequence_ptr);
         const auto initial_angles = parse_initial_angles(initial_angles_ptr);
 
-        const auto code_info = calculate_code_info(CodePair{code_sequence, initial_angles});
+        const CodePair code_pair{code_sequence, initial_angles};
+
+        const auto store = current_store();
+
+        boost::optional<CodeInfo> code_info{};
 
-        copy_to_c_code_info(code_info, c_code_info);
+        if (store) {
+            code_info = store->code_info(code_pair);
+        }
+
+        if (!code_info) {
+            code_info = calculate_code_info(code_pair);
+        }
+
+        copy_to_c_code_info(*code_info, c_code_info);
 
         return 1;
 
@@ -117,7 +158,9 @@ char* check_square(const int64_t numerx, const int64_t numery, const int64_t den
         const auto code_sequence = parse_code_sequence(code_sequence_ptr);
         const auto initial_angles = parse_initial_angles(initial_angles_ptr);
 
-        const auto str = check_square(numerx, numery, denom, code_sequence, initial_angles, cover_dir);
+        const auto store = current_store();
+
+        const auto str = check_square(numerx, numery, denom, code_sequence, initial_angles, cover_dir, store.get());
 
         return to_cstr(str);
 
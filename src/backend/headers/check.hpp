@@ -2,5 +2,8 @@
 
 #include "code_sequence.hpp"
 
+class InfoStore;
+
 std::string check_square(const int64_t numerx, const int64_t numery, const int64_t denom, const CodeSequence& code_seq,
-                         const InitialAngles& initial_angles, const std::string& cover_dir);
+                         const InitialAngles& initial_angles, const std::string& cover_dir,
+                         const InfoStore* const store);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cover.hpp"
+#include "equations.hpp"
+#include "info_store.hpp"
+#include "verify.hpp"
+
+// How much coalesce_cover shrank a cover
+struct CoalesceStats final {
+    uint64_t leaves_before = 0;
+    uint64_t leaves_after = 0;
+
+    // The Divides that were replaced by a single leaf
+    uint64_t merged = 0;
+};
+
+// Rewrites a cover into an equivalent one with fewer leaves. Going bottom-up, a Divide whose
+// quarters are all leaves (after coalescing them) is replaced by
+//
+//   Empty, if none of its square intersects the polygon
+//   Single or Triple, if one of the codes of its quarters proves the whole square
+//
+// and otherwise left alone. The codes that cover the most quarters are tried first. Since the
+// new leaves are checked exactly the same way verify_cover checks them, the new cover verifies
+// whenever the old one did, as long as they are both checked with the same digits.
+//
+// Every code that is tried stays in memory until the end, so this needs more memory than
+// verify_cover, which frees them after their last leaf.
+cover::Cover coalesce_cover(const ClosedRectangleQ& square, const OpenConvexPolygonQ& polygon,
+                            const std::vector<CodePair>& singles,
+                            const std::vector<TriplePair>& triples,
+                            const cover::Cover& cover,
+                            const uint32_t digits,
+                            const VerifyOptions& options,
+                            const InfoStore* const store,
+                            CoalesceStats& stats);
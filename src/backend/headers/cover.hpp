@@ -172,4 +172,7 @@ std::vector<TriplePair> load_triples(const std::string& dir);
 
 cover::Cover load_cover(const std::string& dir);
 
+// Writes the cover in the format of cover.txt, so that load_cover reads it back the same
+void save_cover(const std::string& file, const cover::Cover& cover);
+
 uint32_t load_digits(const std::string& dir);
@@ -153,13 +153,13 @@ struct Inserter {
 
 struct Inserter {
     Curves curves;
-    Evaluator eval;
+    Evaluator& eval;
     const PointQ& center;
     const Rational& rx;
     const Rational& ry;
 
     explicit Inserter(const PointQ& center_, const Rational& rx_, const Rational& ry_)
-        : curves{}, eval{64}, center{center_}, rx{rx_}, ry{ry_} {}
+        : curves{}, eval{thread_evaluator(64)}, center{center_}, rx{rx_}, ry{ry_} {}
 
     void insert(const EqMap<Sin>& eq) {
 
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdint>   // int8_t, int16_t, int32_t, uint32_t
+#include <iterator>  // std::input_iterator_tag
+#include <ostream>   // std::ostream
+#include <set>       // std::set
+#include <stdexcept> // std::runtime_error
+#include <vector>    // std::vector
+
+#include "general.hpp"
+#include "math/interval_kernel.hpp"
+
+// The integer type that the coefficients of an EquationArena are stored as. Every code picks
+// the narrowest one that holds all of its coefficients.
+enum class CoeffWidth : uint8_t {
+    Int8,
+    Int16,
+    Int32,
+};
+
+// The smallest width that can hold every coefficient with absolute value at most max_abs
+CoeffWidth narrowest_width(const Coeff64 max_abs);
+
+// One term t * trig((x * X + y * Y) * pi/2) of a packed equation
+struct PackedTerm final {
+    Coeff64 x;
+    Coeff64 y;
+    Coeff64 t;
+};
+
+template <template <typename> class Trig>
+class EquationView;
+
+// The equations of a code with the same trig function, packed into flat arrays. The
+// coefficients of every term of every equation are stored contiguously, one array each for
+// t, x and y, and equation i is the terms from offsets[i] up to offsets[i + 1]. The gradient
+// bounds and the largest |x| and |y| of each equation are calculated up front.
+//
+// Compared to a vector of equations that each own their terms, this needs no allocation per
+// equation, and since the coefficients are usually small, they take up far less memory.
+template <template <typename> class Trig>
+class EquationArena final {
+  private:
+    template <typename Coeff>
+    struct PackedTerms final {
+        std::vector<Coeff> t;
+        std::vector<Coeff> x;
+        std::vector<Coeff> y;
+
+        math::TermArrays<Coeff> arrays(const size_t begin, const size_t end) const {
+            return {t.data() + begin, x.data() + begin, y.data() + begin, end - begin};
+        }
+    };
+
+    CoeffWidth width_;
+
+    // Only the one for width_ is used
+    PackedTerms<int8_t> terms8;
+    PackedTerms<int16_t> terms16;
+    PackedTerms<int32_t> terms32;
+
+    std::vector<uint32_t> offsets;
+
+    std::vector<Coeff64> bx_;
+    std::vector<Coeff64> by_;
+    std::vector<uint32_t> max_x_;
+    std::vector<uint32_t> max_y_;
+
+    uint32_t precision_;
+
+    template <typename Coeff>
+    void push_back(PackedTerms<Coeff>& terms, const EqMap<Trig>& equation);
+
+    friend class EquationView<Trig>;
+
+  public:
+    explicit EquationArena(const std::set<EqMap<Trig>>& equations, const CoeffWidth width);
+
+    size_t size() const {
+        return bx_.size();
+    }
+
+    CoeffWidth width() const {
+        return width_;
+    }
+
+    // A (very) rough estimate of the precision needed to prove the equations positive once
+    // the double prefilter has failed, based on the size of their coefficients. This only
+    // affects how fast we get there, never the result.
+    uint32_t precision() const {
+        return precision_;
+    }
+
+    EquationView<Trig> operator[](const size_t index) const {
+        return EquationView<Trig>{*this, index};
+    }
+
+    // Calls func with the math::TermArrays of the terms from begin up to end, with whichever
+    // coefficient type the arena uses, and returns its result.
+    template <typename Func>
+    auto visit_terms(const size_t begin, const size_t end, const Func& func) const {
+
+        switch (width_) {
+        case CoeffWidth::Int8:
+            return func(terms8.arrays(begin, end));
+        case CoeffWidth::Int16:
+            return func(terms16.arrays(begin, end));
+        case CoeffWidth::Int32:
+            return func(terms32.arrays(begin, end));
+        }
+
+        throw std::runtime_error("EquationArena: unknown coefficient width");
+    }
+
+    PackedTerm term(const size_t index) const {
+        return visit_terms(index, index + 1, [](const auto& arrays) {
+            return PackedTerm{arrays.a[0], arrays.b[0], arrays.t[0]};
+        });
+    }
+};
+
+// A single equation of an EquationArena. This is only valid as long as the arena is.
+template <template <typename> class Trig>
+class EquationView final {
+  private:
+    const EquationArena<Trig>* arena;
+    size_t index;
+
+  public:
+    class const_iterator final {
+      private:
+        const EquationArena<Trig>* arena;
+        size_t pos;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = PackedTerm;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const PackedTerm*;
+        using reference = PackedTerm;
+
+        explicit const_iterator(const EquationArena<Trig>& arena_, const size_t pos_)
+            : arena{&arena_}, pos{pos_} {}
+
+        PackedTerm operator*() const {
+            return arena->term(pos);
+        }
+
+        const_iterator& operator++() {
+            ++pos;
+            return *this;
+        }
+
+        bool operator==(const const_iterator& rhs) const {
+            return pos == rhs.pos;
+        }
+
+        bool operator!=(const const_iterator& rhs) const {
+            return pos != rhs.pos;
+        }
+    };
+
+    explicit EquationView(const EquationArena<Trig>& arena_, const size_t index_)
+        : arena{&arena_}, index{index_} {}
+
+    const_iterator begin() const {
+        return const_iterator{*arena, arena->offsets.at(index)};
+    }
+
+    const_iterator end() const {
+        return const_iterator{*arena, arena->offsets.at(index + 1)};
+    }
+
+    size_t size() const {
+        return arena->offsets.at(index + 1) - arena->offsets.at(index);
+    }
+
+    // The gradient bounds, see gradient_bounds
+    Coeff64 bx() const {
+        return arena->bx_.at(index);
+    }
+
+    Coeff64 by() const {
+        return arena->by_.at(index);
+    }
+
+    // The largest |x| and |y| coefficients of the terms
+    uint32_t max_x() const {
+        return arena->max_x_.at(index);
+    }
+
+    uint32_t max_y() const {
+        return arena->max_y_.at(index);
+    }
+
+    // Calls func with the math::TermArrays of the terms, see EquationArena::visit_terms
+    template <typename Func>
+    auto visit_terms(const Func& func) const {
+        return arena->visit_terms(arena->offsets.at(index), arena->offsets.at(index + 1), func);
+    }
+
+    // The equation unpacked into its usual form, for printing
+    EqMap<Trig> to_map() const;
+
+    friend std::ostream& operator<<(std::ostream& os, const EquationView<Trig>& eq) {
+        return os << eq.to_map();
+    }
+};
+
+extern template class EquationArena<Sin>;
+extern template class EquationArena<Cos>;
+
+extern template class EquationView<Sin>;
+extern template class EquationView<Cos>;
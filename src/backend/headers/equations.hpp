@@ -1,25 +1,7 @@
 #pragma once
 
 #include "cover.hpp"
-
-template <template <typename> class Trig>
-EqVec<Trig> map_to_vec(const EqMap<Trig>& eq) {
-
-    EqVec<Trig> vec{};
-    for (const auto& kv : eq) {
-
-        const auto x_coeff = kv.first.arg.coeff(XY::X);
-        const auto y_coeff = kv.first.arg.coeff(XY::Y);
-
-        const math::LinComArr<XY, Coeff16> arg{boost::numeric_cast<Coeff16>(x_coeff),
-                                               boost::numeric_cast<Coeff16>(y_coeff)};
-        const Trig<math::LinComArr<XY, Coeff16>> trig{arg};
-
-        vec.coeffs.emplace_back(trig, boost::numeric_cast<Coeff16>(kv.second));
-    }
-
-    return vec;
-}
+#include "equation_arena.hpp"
 
 struct CodeInfo final {
 
@@ -35,46 +17,39 @@ struct CodeInfo final {
           cos_equations{std::move(cos_equations_)} {}
 };
 
+// The narrowest width that holds every coefficient of the equations of a code
+CoeffWidth coeff_width(const CodeInfo& code_info);
+
 struct StableInfo {
 
     OpenConvexPolygonQ polygon;
-    std::vector<std::tuple<EqVec<Sin>, Coeff64, Coeff64>> sines;
-    std::vector<std::tuple<EqVec<Cos>, Coeff64, Coeff64>> cosines;
+    EquationArena<Sin> sines;
+    EquationArena<Cos> cosines;
+
+    // The precision to start the MPFR calculations at, see EquationArena::precision
+    uint32_t precision;
 
     explicit StableInfo(const CodeInfo& code_info)
-        : polygon{code_info.points} {
-
-        for (const auto& equation : code_info.sin_equations) {
-            const auto gbounds = gradient_bounds(equation);
-            sines.emplace_back(map_to_vec(equation), gbounds.first, gbounds.second);
-        }
-
-        for (const auto& equation : code_info.cos_equations) {
-            const auto gbounds = gradient_bounds(equation);
-            cosines.emplace_back(map_to_vec(equation), gbounds.first, gbounds.second);
-        }
-    }
+        : polygon{code_info.points},
+          sines{code_info.sin_equations, coeff_width(code_info)},
+          cosines{code_info.cos_equations, coeff_width(code_info)},
+          precision{std::max(sines.precision(), cosines.precision())} {}
 };
 
 struct UnstableInfo {
 
     OpenSegmentQ segment;
-    std::vector<std::tuple<EqVec<Sin>, Coeff64, Coeff64>> sines;
-    std::vector<std::tuple<EqVec<Cos>, Coeff64, Coeff64>> cosines;
+    EquationArena<Sin> sines;
+    EquationArena<Cos> cosines;
+
+    // See StableInfo::precision
+    uint32_t precision;
 
     explicit UnstableInfo(const CodeInfo& code_info)
-        : segment{code_info.points.at(0), code_info.points.at(1)} {
-
-        for (const auto& equation : code_info.sin_equations) {
-            const auto gbounds = gradient_bounds(equation);
-            sines.emplace_back(map_to_vec(equation), gbounds.first, gbounds.second);
-        }
-
-        for (const auto& equation : code_info.cos_equations) {
-            const auto gbounds = gradient_bounds(equation);
-            cosines.emplace_back(map_to_vec(equation), gbounds.first, gbounds.second);
-        }
-    }
+        : segment{code_info.points.at(0), code_info.points.at(1)},
+          sines{code_info.sin_equations, coeff_width(code_info)},
+          cosines{code_info.cos_equations, coeff_width(code_info)},
+          precision{std::max(sines.precision(), cosines.precision())} {}
 };
 
 struct TripleInfo {
@@ -91,7 +66,25 @@ struct TripleInfo {
           stable_pos_info{std::move(stable_pos_info_)} {}
 };
 
+// The code infos of a triple, with the factor of the unstable code already divided out of
+// the stable ones
+struct TripleCodeInfo final {
+    CodeInfo stable_neg;
+    CodeInfo unstable;
+    CodeInfo stable_pos;
+};
+
+class InfoStore;
+
 CodeInfo calculate_code_info(const CodePair& code_pair);
 
-std::map<size_t, std::pair<CodePair, StableInfo>> load_single_infos(const std::vector<CodePair>& singles);
-std::map<size_t, std::pair<TriplePair, TripleInfo>> load_triple_infos(const std::vector<TriplePair>& triples);
+TripleCodeInfo calculate_triple_code_info(const TriplePair& triple);
+
+// With a store, the infos are read from it if it has them, and only calculated otherwise
+StableInfo calculate_single_info(const CodePair& single, const InfoStore* const store);
+TripleInfo calculate_triple_info(const TriplePair& triple, const InfoStore* const store);
+
+std::map<size_t, std::pair<CodePair, StableInfo>> load_single_infos(const std::vector<CodePair>& singles,
+                                                                    const InfoStore* const store = nullptr);
+std::map<size_t, std::pair<TriplePair, TripleInfo>> load_triple_infos(const std::vector<TriplePair>& triples,
+                                                                      const InfoStore* const store = nullptr);
@@ -1,11 +1,90 @@
 #pragma once
 
+#include <map>
+#include <vector>
+
+#include <boost/optional.hpp>
 #include <mpfr.h>
 
+#include "equation_arena.hpp"
 #include "general.hpp"
+#include "math/complex_interval.hpp"
+#include "math/interval_kernel.hpp"
+
+struct StableInfo;
+struct UnstableInfo;
+
+// Bounds on sin and cos of a reduced argument frac * pi/2, where 0 <= frac < 1.
+// The _d bounds are rounded down, and the _u bounds are rounded up.
+struct TrigBounds {
+    mpfr_t sin_d;
+    mpfr_t sin_u;
+    mpfr_t cos_d;
+    mpfr_t cos_u;
+};
+
+// The value and gradient of an equation at a center, and a bound on the absolute value of
+// d^T H d over a box around it, where H is the Hessian.
+struct DoubleTaylor {
+    math::DoubleInterval value;
+    math::DoubleInterval dx;
+    math::DoubleInterval dy;
+    math::DoubleInterval curvature;
+};
+
+// Which equations of a code are already proven positive over a box, by index into its sines
+// and cosines. An equation that is positive over a box is positive over every box inside it,
+// so these never need to be checked again in there. See Evaluator::retire_positive.
+struct RetiredEquations final {
+    std::vector<bool> sines;
+    std::vector<bool> cosines;
+};
+
+// How the double prefilter evaluates trig terms.
+//
+// Reduce: reduce each argument and calculate its sin and cos with a Taylor series.
+// Powers: since every argument is a*x*pi/2 + b*y*pi/2 for integers a and b, every term is
+//         s^a * t^b for s = e^{ix*pi/2} and t = e^{iy*pi/2}. We calculate s and t once per
+//         center, and then each term only costs a complex multiplication.
+enum class TrigMode {
+    Reduce,
+    Powers,
+};
 
 class Evaluator {
   private:
+    // Lets the tests compare the two ways of reducing an argument
+    friend struct EvaluatorTestAccess;
+
+    // The region around a center that the equations are checked on: either the box with
+    // radii x and y, or the segment from center - (x, y) to center + (x, y).
+    struct Extent final {
+        const Rational& x;
+        const Rational& y;
+        bool segment;
+    };
+
+    // The MPFR calculations start at start_precision, and double the precision each time
+    // the result is inconclusive, up to the maximum precision.
+    uint32_t precision;
+    uint32_t start_precision;
+    TrigMode mode;
+
+    // How many equations were proved positive at each precision. 0 is the double prefilter.
+    std::map<uint32_t, uint64_t> histogram;
+
+    // The center of the double prefilter, and the powers of s and t at it
+    math::DoubleInterval x_double;
+    math::DoubleInterval y_double;
+    math::UnitPowers x_powers;
+    math::UnitPowers y_powers;
+
+    // The same powers as flat arrays for the SIMD kernel. kernel_valid is false if the
+    // powers are too wide for the kernel.
+    math::PowerArrays x_arrays;
+    math::PowerArrays y_arrays;
+    bool kernel_valid;
+
     mpz_t quot;
     mpz_t rem;
 
@@ -16,38 +95,182 @@ class Evaluator {
     mpfr_t term;
     mpfr_t sum;
 
-    mpfr_t half_pi_d;
-    mpfr_t half_pi_u;
+    // These are shared between every Evaluator with the same precision. See HalfPi.
+    mpfr_srcptr half_pi_d;
+    mpfr_srcptr half_pi_u;
+
+    // Scratch space for all_positive. These are reused between calls so that we don't
+    // need to allocate (and initialize the MPFR values) each time.
+    std::vector<std::pair<Coeff64, Coeff64>> args;
+    std::vector<uint8_t> uses;
+    std::vector<unsigned long> quads;
+    std::vector<TrigBounds> bounds;
+    std::vector<EquationView<Sin>> pending_sines;
+    std::vector<EquationView<Cos>> pending_cosines;
+    std::vector<EquationView<Sin>> failed_sines;
+    std::vector<EquationView<Cos>> failed_cosines;
+
+    uint32_t next_precision(const uint32_t prec) const;
+
+    void set_working_precision(const uint32_t prec);
+
+    bool set_double_center(const PointQ& center);
+
+    template <template <typename> class Trig, typename Eq>
+    DoubleTaylor double_taylor(const Eq& eq, const math::DoubleInterval& rx, const math::DoubleInterval& ry);
+
+    template <template <typename> class Trig>
+    DoubleTaylor double_taylor(const EquationView<Trig>& eq, const math::DoubleInterval& rx, const math::DoubleInterval& ry);
+
+    template <template <typename> class Trig, typename Eq>
+    bool double_is_positive(const Eq& eq, const Coeff64 bx, const Coeff64 by,
+                            const Rational& rx, const Rational& ry);
+
+    template <template <typename> class Trig>
+    bool double_is_positive_along(const EquationView<Trig>& eq, const Rational& dx, const Rational& dy);
+
+    template <template <typename> class Trig>
+    bool double_is_positive(const EquationView<Trig>& eq, const Extent& extent);
+
+    unsigned long reduce(const Coeff64 x_coeff, const Coeff64 y_coeff, const PointQ& center);
+    unsigned long reduce_rational(const Coeff64 x_coeff, const Coeff64 y_coeff, const PointQ& center);
+    unsigned long reduce_dyadic(const Coeff64 x_coeff, const Coeff64 y_coeff, const PointQ& center);
+
+    template <template <typename> class Trig>
+    void add_uses(const EquationView<Trig>& eq);
+
+    void calculate_bounds(const size_t index);
+
+    void calculate_shared_bounds(const PointQ& center, const uint32_t prec);
+
+    template <template <typename> class Trig>
+    void sum_terms(const EquationView<Trig>& eq);
+
+    template <template <typename> class Trig>
+    void bound_term(const EquationView<Trig>& eq, const Extent& extent);
+
+    void add_pending(const EquationView<Sin>& eq);
+    void add_pending(const EquationView<Cos>& eq);
+
+    bool pending_positive(const PointQ& center, const Extent& extent);
+
+    template <typename Info>
+    bool all_positive(const Info& info, const PointQ& center, const Extent& extent,
+                      const RetiredEquations* const retired);
 
   public:
-    explicit Evaluator(const uint32_t prec);
+    explicit Evaluator(const uint32_t prec, const TrigMode mode_ = TrigMode::Powers);
+
+    Evaluator(const Evaluator&) = delete;
+    Evaluator& operator=(const Evaluator&) = delete;
 
     ~Evaluator();
 
-    template <template <typename> class Trig>
-    bool is_positive(const EqVec<Trig>& eq, const Coeff64 bound,
-                     const PointQ& center, const Rational& radius);
+    // The precision to start the MPFR calculations at. This is clamped to the maximum precision.
+    void set_start_precision(const uint32_t prec);
+
+    const std::map<uint32_t, uint64_t>& precision_histogram() const;
 
+    void clear_precision_histogram();
+
+    // The gradient bounds are the ones stored with the equation
     template <template <typename> class Trig>
-    bool is_positive(const EqVec<Trig>& eq, const Coeff64 bx, const Coeff64 by,
+    bool is_positive(const EquationView<Trig>& eq,
                      const PointQ& center, const Rational& rx, const Rational& ry);
 
     template <template <typename> class Trig>
     bool is_positive(const EqMap<Trig>& eq, const Coeff64 bx, const Coeff64 by,
                      const PointQ& center, const Rational& rx, const Rational& ry);
+
+    // An enclosure of f(center) - (bx * rx + by * ry) * pi/2, which is how far the first order
+    // test passes by (or fails by, if it is negative). This is as rigorous as is_positive, but
+    // only accurate to about 1e-13. Returns none if the center or radii are too large for doubles.
+    template <template <typename> class Trig>
+    boost::optional<math::DoubleInterval> margin(const EquationView<Trig>& eq,
+                                                 const PointQ& center, const Rational& rx, const Rational& ry);
+
+    // Check that every equation of a code is positive over the box with the given center and
+    // radii. This gives exactly the same results as calling is_positive on each equation,
+    // but each distinct trig argument is only reduced and evaluated once, and the result is
+    // shared between all of the equations that use it.
+    template <typename Info>
+    bool all_positive(const Info& info, const PointQ& center, const Rational& rx, const Rational& ry);
+
+    // The same as all_positive, but skipping the retired equations
+    template <typename Info>
+    bool all_positive(const Info& info, const PointQ& center, const Rational& rx, const Rational& ry,
+                      const RetiredEquations& retired);
+
+    // Retire every equation of a code that the double prefilter proves positive over the box,
+    // and return how many there were. The ones that are already retired are skipped.
+    template <typename Info>
+    size_t retire_positive(const Info& info, const PointQ& center, const Rational& rx, const Rational& ry,
+                           RetiredEquations& retired);
+
+    // The same as is_positive and all_positive, but only on the segment from center - (dx, dy)
+    // to center + (dx, dy). Since we only need to bound the derivative along the segment, this
+    // proves far more than checking the box around it.
+    template <template <typename> class Trig>
+    bool is_positive_along(const EquationView<Trig>& eq,
+                           const PointQ& center, const Rational& dx, const Rational& dy);
+
+    template <typename Info>
+    bool all_positive_along(const Info& info, const PointQ& center, const Rational& dx, const Rational& dy);
+
+    // The same as margin, but for the first order test along the segment, which is f(center)
+    // minus the sum of |t| * |a * dx + b * dy| * pi/2. See double_is_positive_along.
+    template <template <typename> class Trig>
+    boost::optional<math::DoubleInterval> margin_along(const EquationView<Trig>& eq,
+                                                       const PointQ& center, const Rational& dx, const Rational& dy);
 };
 
-extern template bool Evaluator::is_positive(const EqVec<Sin>& eq, const Coeff64 bound,
-                                            const PointQ& center, const Rational& radius);
-extern template bool Evaluator::is_positive(const EqVec<Cos>& eq, const Coeff64 bound,
-                                            const PointQ& center, const Rational& radius);
+// An Evaluator with the given (maximum) precision that belongs to the calling thread. Setting
+// up an Evaluator is not free, so this lets us reuse them instead of creating one per square.
+// Since it is shared by everything on the thread, do not hold on to it across anything that
+// may run other tasks on the same thread (such as a nested tbb algorithm).
+Evaluator& thread_evaluator(const uint32_t prec);
 
-extern template bool Evaluator::is_positive(const EqVec<Sin>& eq, const Coeff64 bx, const Coeff64 by,
+extern template bool Evaluator::is_positive(const EquationView<Sin>& eq,
                                             const PointQ& center, const Rational& rx, const Rational& ry);
-extern template bool Evaluator::is_positive(const EqVec<Cos>& eq, const Coeff64 bx, const Coeff64 by,
+extern template bool Evaluator::is_positive(const EquationView<Cos>& eq,
                                             const PointQ& center, const Rational& rx, const Rational& ry);
 
+extern template boost::optional<math::DoubleInterval> Evaluator::margin(const EquationView<Sin>& eq,
+                                                                      const PointQ& center, const Rational& rx, const Rational& ry);
+extern template boost::optional<math::DoubleInterval> Evaluator::margin(const EquationView<Cos>& eq,
+                                                                      const PointQ& center, const Rational& rx, const Rational& ry);
+
+extern template boost::optional<math::DoubleInterval> Evaluator::margin_along(const EquationView<Sin>& eq,
+                                                                            const PointQ& center, const Rational& dx, const Rational& dy);
+extern template boost::optional<math::DoubleInterval> Evaluator::margin_along(const EquationView<Cos>& eq,
+                                                                            const PointQ& center, const Rational& dx, const Rational& dy);
+
 extern template bool Evaluator::is_positive(const EqMap<Sin>& eq, const Coeff64 bx, const Coeff64 by,
                                             const PointQ& center, const Rational& rx, const Rational& ry);
 extern template bool Evaluator::is_positive(const EqMap<Cos>& eq, const Coeff64 bx, const Coeff64 by,
                                             const PointQ& center, const Rational& rx, const Rational& ry);
+
+extern template bool Evaluator::all_positive(const StableInfo& info, const PointQ& center,
+                                             const Rational& rx, const Rational& ry);
+extern template bool Evaluator::all_positive(const UnstableInfo& info, const PointQ& center,
+                                             const Rational& rx, const Rational& ry);
+
+extern template bool Evaluator::all_positive(const StableInfo& info, const PointQ& center,
+                                             const Rational& rx, const Rational& ry, const RetiredEquations& retired);
+extern template bool Evaluator::all_positive(const UnstableInfo& info, const PointQ& center,
+                                             const Rational& rx, const Rational& ry, const RetiredEquations& retired);
+
+extern template size_t Evaluator::retire_positive(const StableInfo& info, const PointQ& center,
+                                                  const Rational& rx, const Rational& ry, RetiredEquations& retired);
+extern template size_t Evaluator::retire_positive(const UnstableInfo& info, const PointQ& center,
+                                                  const Rational& rx, const Rational& ry, RetiredEquations& retired);
+
+extern template bool Evaluator::is_positive_along(const EquationView<Sin>& eq,
+                                                  const PointQ& center, const Rational& dx, const Rational& dy);
+extern template bool Evaluator::is_positive_along(const EquationView<Cos>& eq,
+                                                  const PointQ& center, const Rational& dx, const Rational& dy);
+
+extern template bool Evaluator::all_positive_along(const StableInfo& info, const PointQ& center,
+                                                   const Rational& dx, const Rational& dy);
+extern template bool Evaluator::all_positive_along(const UnstableInfo& info, const PointQ& center,
+                                                   const Rational& dx, const Rational& dy);
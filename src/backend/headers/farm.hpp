@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Checking a cover with any number of worker processes, on one machine or on several that
+// share a file system, that take subtrees from a coordinator as they become free. This
+// balances itself, unlike the fixed shards of plan_shards, whose estimates can be way off.
+//
+// Everything goes through a spool directory, where every step is a rename, which is atomic:
+//
+//   farm             the cover digest and number of items, written once todo is filled
+//   todo/N           item N (ranked from most to least expensive) waiting for a worker,
+//                    holding the path of its subtree
+//   claimed/N.W      item N being checked by worker W
+//   done/N           whether item N was covered
+//   workers/W        touched by worker W every heartbeat, so the coordinator can tell that it
+//                    is still alive
+//   stop             written by the coordinator once every item is done
+//
+// A worker that has not touched its file for the timeout is taken to be dead, and its items go
+// back into todo. If it was only slow, the item just gets checked twice. Both the coordinator
+// and the workers can be restarted at any time, and pick up where the spool directory is.
+// The clocks of the machines need to agree to well within the timeout.
+struct FarmOptions final {
+    std::chrono::milliseconds heartbeat{std::chrono::seconds{5}};
+    std::chrono::milliseconds timeout{std::chrono::seconds{60}};
+
+    // How often the coordinator looks for dead workers, and idle workers look for items
+    std::chrono::milliseconds poll{std::chrono::seconds{1}};
+};
+
+// Hands out the subtrees at the given paths until every one is done, and returns whether they
+// were all covered
+bool run_coordinator(const std::string& spool, const uint64_t digest, const std::vector<std::string>& paths,
+                     const FarmOptions& options);
+
+// Checks subtrees with verify until the coordinator says to stop, and returns how many it
+// checked. The id must be unique among the workers.
+uint64_t run_worker(const std::string& spool, const uint64_t digest, const std::string& id,
+                    const std::function<bool(const std::string&)>& verify, const FarmOptions& options);
+
+// The host name and process id
+std::string default_worker_id();
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <tbb/concurrent_hash_map.h>
+
+#include "equations.hpp"
+
+// How many leaves of a cover use each single and triple, by index
+struct CodeUses final {
+    std::map<size_t, uint64_t> singles;
+    std::map<size_t, uint64_t> triples;
+};
+
+// The infos of the codes of a cover, calculated the first time a leaf needs them, and freed
+// once every leaf that uses them has released them. Only the codes of the part of the cover
+// that is being checked are in memory at once, instead of every code up front.
+//
+// Every leaf that uses a code acquires it, and then releases it once. Anything else may also
+// acquire a code without releasing it, as long as a leaf that uses it is still to come.
+// Acquiring a code after its last use, or one that has no uses, is an error. More uses can be
+// added at any time, for example as a farm worker claims more of the cover, and a code that
+// is still in memory then stays there for them. This is safe to
+// use from multiple threads, and a code that several threads need at the same time is only
+// calculated once.
+class InfoCache final {
+  private:
+    template <typename Info>
+    struct Entry final {
+        // Empty until the first acquire
+        std::shared_ptr<const Info> info;
+        uint64_t uses;
+    };
+
+    template <typename Info>
+    using Table = tbb::concurrent_hash_map<size_t, Entry<Info>>;
+
+    const std::vector<CodePair>& singles_;
+    const std::vector<TriplePair>& triples_;
+
+    // Where to read the infos from before calculating them, if not null
+    const InfoStore* const store;
+
+    Table<StableInfo> single_table;
+    Table<TripleInfo> triple_table;
+
+    // The number of infos in memory, and the most there have been
+    std::atomic<size_t> loaded;
+    std::atomic<size_t> peak_;
+
+    template <typename Info, typename Pair, typename Calculate>
+    std::shared_ptr<const Info> acquire(Table<Info>& table, const std::vector<Pair>& pairs,
+                                        const size_t index, const Calculate& calculate);
+
+    template <typename Info>
+    void release(Table<Info>& table, const size_t index);
+
+    template <typename Info>
+    static void add_uses(Table<Info>& table, const std::map<size_t, uint64_t>& uses);
+
+  public:
+    explicit InfoCache(const std::vector<CodePair>& singles, const std::vector<TriplePair>& triples, const CodeUses& uses,
+                       const InfoStore* const store_ = nullptr);
+
+    InfoCache(const InfoCache&) = delete;
+    InfoCache& operator=(const InfoCache&) = delete;
+
+    const std::vector<CodePair>& singles() const {
+        return singles_;
+    }
+
+    const std::vector<TriplePair>& triples() const {
+        return triples_;
+    }
+
+    // Add to the uses of each code, as with the uses given to the constructor
+    void add_uses(const CodeUses& uses);
+
+    std::shared_ptr<const StableInfo> acquire_single(const size_t index);
+    std::shared_ptr<const TripleInfo> acquire_triple(const size_t index);
+
+    void release_single(const size_t index);
+    void release_triple(const size_t index);
+
+    size_t peak() const {
+        return peak_;
+    }
+};
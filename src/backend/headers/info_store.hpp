@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "equations.hpp"
+
+// A file of precalculated code infos, so that they don't need to be calculated again on every
+// run. The infos of a code never change, so each one is stored under the text of its CodePair
+// (or TriplePair), and any cover with the same codes can use the same store. The file is mapped
+// into memory read-only, and only the infos that are looked up are ever read.
+//
+// The layout is, in native byte order:
+//
+//   header   "COVRINFO", the format version, a byte order mark, the info version, the number
+//            of entries and the offset of the index
+//   values   the infos of each entry, one after the other
+//   index    for each entry the hash of its key, and the offsets and sizes of its key and value,
+//            sorted by hash
+//
+// The info version changes whenever calculate_code_info starts to give different results, so
+// that a store from an older build is refused instead of silently used.
+class InfoStore final {
+  private:
+    std::string file_name;
+
+    const char* data;
+    size_t size;
+
+    uint64_t entries;
+    uint64_t index_offset;
+
+    // The start and end of the value stored under the key, if there is one
+    boost::optional<std::pair<const char*, const char*>> find(const std::string& key) const;
+
+    // Copies the values that it already has
+    friend void write_info_store(const std::string& file,
+                                 const std::vector<CodePair>& codes,
+                                 const std::vector<TriplePair>& triples,
+                                 const InfoStore* const old);
+
+  public:
+    explicit InfoStore(const std::string& file);
+
+    InfoStore(const InfoStore&) = delete;
+    InfoStore& operator=(const InfoStore&) = delete;
+
+    ~InfoStore();
+
+    uint64_t count() const {
+        return entries;
+    }
+
+    boost::optional<CodeInfo> code_info(const CodePair& code_pair) const;
+    boost::optional<TripleCodeInfo> triple_code_info(const TriplePair& triple_pair) const;
+};
+
+// The store in the file, or none if there is no such file
+std::unique_ptr<const InfoStore> load_info_store(const std::string& file);
+
+// Where a cover directory keeps its store by default
+std::string default_info_store(const std::string& cover_dir);
+
+// Writes a new store with the infos of the codes and triples, which are calculated in parallel.
+// Anything that is already in the old store is copied from it instead.
+void write_info_store(const std::string& file,
+                      const std::vector<CodePair>& codes,
+                      const std::vector<TriplePair>& triples,
+                      const InfoStore* const old);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+
+// A record of the subtrees of a cover that have been verified, so that a run that is killed
+// part way through can be resumed. Each subtree is identified by its path from the root of
+// the quadtree, one digit (the index of the quarter) per level, so the root is the empty path.
+//
+// The file starts with a header line that identifies the cover by its digest (see
+// cover_digest), followed by one path per line. Paths are buffered in memory and written (and synced to disk) in batches, so a crash
+// loses at most the last batch, which just gets verified again.
+class Journal final {
+  private:
+    // Write and sync once this many paths are waiting, or once this much time has passed
+    static constexpr size_t batch_size = 1024;
+    static constexpr std::chrono::seconds batch_time{30};
+
+    std::string file_name;
+    int fd;
+
+    std::mutex mutex;
+    std::string buffer;
+    size_t pending;
+    std::chrono::steady_clock::time_point last_sync;
+
+    void write_buffer();
+
+  public:
+    // If append is false, any existing journal is replaced
+    explicit Journal(const std::string& file, const uint64_t cover, const bool append);
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    ~Journal();
+
+    void record(const std::string& path);
+
+    // Write and sync everything recorded so far
+    void flush();
+};
+
+// The paths recorded in a journal of the cover with the given digest. The journal not existing
+// is the same as it being empty, but one for a different cover is an error.
+std::set<std::string> load_journal(const std::string& file, const uint64_t cover);
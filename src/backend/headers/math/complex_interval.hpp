@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint> // int64_t, uint64_t
+#include <vector>  // std::vector
+
+#include "math/arith.hpp"
+#include "math/double_interval.hpp"
+
+namespace math {
+
+// A rectangle in the complex plane that is guaranteed to contain the true value.
+struct ComplexInterval final {
+    DoubleInterval re;
+    DoubleInterval im;
+
+    explicit ComplexInterval(const DoubleInterval& re_, const DoubleInterval& im_)
+        : re{re_}, im{im_} {}
+
+    friend ComplexInterval operator*(const ComplexInterval& lhs, const ComplexInterval& rhs) {
+        // (a + bi)(c + di) = (ac - bd) + (ad + bc)i
+        return ComplexInterval{lhs.re * rhs.re - lhs.im * rhs.im,
+                               lhs.re * rhs.im + lhs.im * rhs.re};
+    }
+
+    friend ComplexInterval conj(const ComplexInterval& val) {
+        return ComplexInterval{val.re, -val.im};
+    }
+};
+
+// The powers z^n of a complex number z on the unit circle, built incrementally as they are
+// needed. Since |z| = 1, we have z^{-n} = conj(z^n), and the real and imaginary parts of
+// every power are in [-1, 1], which we use to keep the enclosures from growing too wide.
+class UnitPowers final {
+  private:
+    // powers[n] = z^n
+    std::vector<ComplexInterval> powers;
+
+  public:
+    void reset(const ComplexInterval& base) {
+        powers.clear();
+        powers.emplace_back(DoubleInterval{1, 1}, DoubleInterval{0, 0});
+        powers.push_back(base);
+    }
+
+    ComplexInterval operator()(const int64_t n) {
+
+        const auto abs_n = static_cast<uint64_t>(math::abs(n));
+
+        while (powers.size() <= abs_n) {
+
+            const auto m = powers.size();
+
+            // z^m = z^{m/2} * z^{m - m/2}. Each multiplication can widen the enclosure by up
+            // to a factor of sqrt(2) (a rotated rectangle needs a larger rectangle to contain
+            // it), so splitting the power in half keeps the width to about m^1.5 times that of
+            // z, instead of growing exponentially as it would with z^m = z^{m-1} * z.
+            const auto prod = powers.at(m / 2) * powers.at(m - m / 2);
+
+            powers.emplace_back(clamp_unit(prod.re.lower(), prod.re.upper()),
+                                clamp_unit(prod.im.lower(), prod.im.upper()));
+        }
+
+        const auto& power = powers.at(abs_n);
+
+        if (n < 0) {
+            return conj(power);
+        } else {
+            return power;
+        }
+    }
+};
+}
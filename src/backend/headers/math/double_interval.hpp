@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm> // std::min, std::max
+#include <cmath>     // std::nextafter, std::round, std::isfinite
+#include <cstdint>   // int64_t
+#include <limits>    // std::numeric_limits
+#include <ostream>   // std::ostream
+#include <stdexcept> // std::runtime_error
+
+namespace math {
+
+// A closed interval of doubles that is guaranteed to contain the true value of whatever
+// real number it represents.
+//
+// We do not change the FPU rounding mode, since that is slow, global to the thread, and the
+// optimizer is free to ignore it unless we compile with -frounding-math. Instead, every
+// operation is done in the default round-to-nearest mode, and the result is then widened by
+// one ULP in each direction. Since a correctly rounded result is always within half an ULP of
+// the true result, the widened interval is guaranteed to contain it.
+class DoubleInterval final {
+  private:
+    double lower_;
+    double upper_;
+
+  public:
+    static double down(const double val) {
+        return std::nextafter(val, -std::numeric_limits<double>::infinity());
+    }
+
+    static double up(const double val) {
+        return std::nextafter(val, std::numeric_limits<double>::infinity());
+    }
+
+    explicit DoubleInterval(const double lower, const double upper)
+        : lower_{lower}, upper_{upper} {
+
+        // This also catches NaNs
+        if (!(lower_ <= upper_)) {
+            throw std::runtime_error("invalid DoubleInterval: lower > upper");
+        }
+    }
+
+    // An interval that surely contains a value that was rounded (in any direction)
+    // to the nearest double.
+    static DoubleInterval around(const double val) {
+        return DoubleInterval{down(val), up(val)};
+    }
+
+    double lower() const {
+        return lower_;
+    }
+
+    double upper() const {
+        return upper_;
+    }
+
+    // The midpoint is not exact, so it is only useful as an approximation
+    double midpoint() const {
+        return lower_ + (upper_ - lower_) / 2;
+    }
+
+    bool is_finite() const {
+        return std::isfinite(lower_) && std::isfinite(upper_);
+    }
+
+    friend DoubleInterval operator+(const DoubleInterval& lhs, const DoubleInterval& rhs) {
+        return DoubleInterval{down(lhs.lower_ + rhs.lower_), up(lhs.upper_ + rhs.upper_)};
+    }
+
+    friend DoubleInterval operator-(const DoubleInterval& lhs, const DoubleInterval& rhs) {
+        return DoubleInterval{down(lhs.lower_ - rhs.upper_), up(lhs.upper_ - rhs.lower_)};
+    }
+
+    friend DoubleInterval operator-(const DoubleInterval& val) {
+        // Negation is exact
+        return DoubleInterval{-val.upper_, -val.lower_};
+    }
+
+    friend DoubleInterval operator*(const DoubleInterval& lhs, const DoubleInterval& rhs) {
+
+        const double ll = lhs.lower_ * rhs.lower_;
+        const double lu = lhs.lower_ * rhs.upper_;
+        const double ul = lhs.upper_ * rhs.lower_;
+        const double uu = lhs.upper_ * rhs.upper_;
+
+        const double lower = std::min(std::min(ll, lu), std::min(ul, uu));
+        const double upper = std::max(std::max(ll, lu), std::max(ul, uu));
+
+        return DoubleInterval{down(lower), up(upper)};
+    }
+
+    // Scaling by an integer. All of the coefficients we deal with are far smaller than 2^53,
+    // and so are exactly representable as doubles.
+    friend DoubleInterval operator*(const int64_t scale, const DoubleInterval& val) {
+
+        const int64_t max_exact = 1LL << 53;
+
+        const auto s = static_cast<double>(scale);
+
+        if (scale > max_exact || scale < -max_exact) {
+            // The conversion may have been inexact, so we need to account for it
+            return DoubleInterval::around(s) * val;
+        } else if (scale >= 0) {
+            return DoubleInterval{down(s * val.lower_), up(s * val.upper_)};
+        } else {
+            return DoubleInterval{down(s * val.upper_), up(s * val.lower_)};
+        }
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const DoubleInterval& val) {
+        return os << '[' << val.lower_ << ", " << val.upper_ << ']';
+    }
+};
+
+// pi/2 lies strictly between these two consecutive doubles. Regardless of which way the
+// literal is rounded, stepping one ULP in each direction is guaranteed to enclose it.
+inline DoubleInterval half_pi_interval() {
+    return DoubleInterval::around(1.5707963267948966);
+}
+
+// sin(t) and cos(t) for |t| <= 1, calculated with their Taylor series up to t^17 and t^18
+// respectively.
+//
+// The error of these approximations is bounded by the sum of
+// - the truncation error, which is at most 1/19! < 2^-55 for |t| <= 1.
+// - the rounding error of the Horner evaluation. With 9 steps of a multiply and an add,
+//   this is at most gamma_19 * sum(|c_i| * |t|^i) <= 19 * 2^-53 * e < 2^-46.
+// - the rounding error of the coefficients themselves, which is at most 2^-53 * e.
+// Hence 2^-45 is a (very) safe bound on the total error.
+struct SinCosApprox final {
+
+    static constexpr double max_arg = 1.0;
+    static constexpr double max_error = 1.0 / (1LL << 45);
+
+    static double sin(const double t) {
+
+        const double t2 = t * t;
+
+        // 1/(2k+1)! for k = 8, ..., 1
+        double acc = 1.0 / 355687428096000.0;
+        acc = acc * t2 - 1.0 / 1307674368000.0;
+        acc = acc * t2 + 1.0 / 6227020800.0;
+        acc = acc * t2 - 1.0 / 39916800.0;
+        acc = acc * t2 + 1.0 / 362880.0;
+        acc = acc * t2 - 1.0 / 5040.0;
+        acc = acc * t2 + 1.0 / 120.0;
+        acc = acc * t2 - 1.0 / 6.0;
+        acc = acc * t2 + 1.0;
+
+        return acc * t;
+    }
+
+    static double cos(const double t) {
+
+        const double t2 = t * t;
+
+        // 1/(2k)! for k = 9, ..., 1
+        double acc = -1.0 / 6402373705728000.0;
+        acc = acc * t2 + 1.0 / 20922789888000.0;
+        acc = acc * t2 - 1.0 / 87178291200.0;
+        acc = acc * t2 + 1.0 / 479001600.0;
+        acc = acc * t2 - 1.0 / 3628800.0;
+        acc = acc * t2 + 1.0 / 40320.0;
+        acc = acc * t2 - 1.0 / 720.0;
+        acc = acc * t2 + 1.0 / 24.0;
+        acc = acc * t2 - 1.0 / 2.0;
+        acc = acc * t2 + 1.0;
+
+        return acc;
+    }
+};
+
+// Enclosures of sin(u * pi/2) and cos(u * pi/2) for every u in the given interval.
+struct SinCosInterval final {
+    DoubleInterval sin;
+    DoubleInterval cos;
+
+    explicit SinCosInterval(const DoubleInterval& sin_, const DoubleInterval& cos_)
+        : sin{sin_}, cos{cos_} {}
+};
+
+inline DoubleInterval clamp_unit(const double lower, const double upper) {
+    return DoubleInterval{std::max(lower, -1.0), std::min(upper, 1.0)};
+}
+
+inline SinCosInterval sin_cos_half_pi(const DoubleInterval& u) {
+
+    const DoubleInterval unit{-1.0, 1.0};
+
+    // Past this point the reduction below would lose too much precision to be useful
+    // (and the conversion to an integer may overflow).
+    const double max_reduce = 1LL << 40;
+
+    if (!u.is_finite() || u.lower() < -max_reduce || u.upper() > max_reduce) {
+        return SinCosInterval{unit, unit};
+    }
+
+    // u = k + f, where k is an integer and f is (roughly) in [-1/2, 1/2].
+    // Since k is an integer, sin((k + f) * pi/2) and cos((k + f) * pi/2) reduce
+    // to +/- sin(f * pi/2) or +/- cos(f * pi/2) based on k mod 4.
+    const double k = std::round(u.midpoint());
+    const auto f = u - DoubleInterval{k, k};
+    const auto theta = f * half_pi_interval();
+
+    if (theta.lower() < -SinCosApprox::max_arg || theta.upper() > SinCosApprox::max_arg) {
+        return SinCosInterval{unit, unit};
+    }
+
+    // Both sin and cos are 1-Lipschitz, so their values over theta are within
+    // radius of their values at the (approximate) midpoint.
+    const double mid = theta.midpoint();
+    const double radius = DoubleInterval::up(std::max(mid - theta.lower(), theta.upper() - mid));
+    const double error = DoubleInterval::up(radius + SinCosApprox::max_error);
+
+    const double sin_mid = SinCosApprox::sin(mid);
+    const double cos_mid = SinCosApprox::cos(mid);
+
+    const auto sin_theta = clamp_unit(DoubleInterval::down(sin_mid - error), DoubleInterval::up(sin_mid + error));
+    const auto cos_theta = clamp_unit(DoubleInterval::down(cos_mid - error), DoubleInterval::up(cos_mid + error));
+
+    // k mod 4, but in [0, 4) even for negative k
+    const auto quad = ((static_cast<int64_t>(k) % 4) + 4) % 4;
+
+    if (quad == 0) {
+        // sin(x + 0) = sin(x), cos(x + 0) = cos(x)
+        return SinCosInterval{sin_theta, cos_theta};
+    } else if (quad == 1) {
+        // sin(x + pi/2) = cos(x), cos(x + pi/2) = -sin(x)
+        return SinCosInterval{cos_theta, -sin_theta};
+    } else if (quad == 2) {
+        // sin(x + pi) = -sin(x), cos(x + pi) = -cos(x)
+        return SinCosInterval{-sin_theta, -cos_theta};
+    } else {
+        // sin(x + 3pi/2) = -cos(x), cos(x + 3pi/2) = sin(x)
+        return SinCosInterval{-cos_theta, sin_theta};
+    }
+}
+}
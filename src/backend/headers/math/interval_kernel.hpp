@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // int8_t, int16_t, int32_t
+#include <vector>  // std::vector
+
+#include "math/complex_interval.hpp"
+
+namespace math {
+
+// The powers z^0, ..., z^n of a complex number on the unit circle, stored as midpoints and
+// radii in separate arrays so that sum_terms can gather them. The true value of z^k is
+// within rad[k] of re[k] + i*im[k].
+class PowerArrays final {
+  private:
+    std::vector<double> re_;
+    std::vector<double> im_;
+    std::vector<double> rad_;
+
+  public:
+    // The error analysis of sum_terms assumes that the radii are tiny
+    static constexpr double max_radius = 1.0 / (1 << 20);
+
+    void clear();
+
+    // Make sure that z^0, ..., z^n are present. Returns false if any of their enclosures are
+    // too wide, in which case these arrays must not be used.
+    bool extend(UnitPowers& powers, const size_t n);
+
+    size_t size() const {
+        return re_.size();
+    }
+
+    const double* re() const {
+        return re_.data();
+    }
+
+    const double* im() const {
+        return im_.data();
+    }
+
+    const double* rad() const {
+        return rad_.data();
+    }
+};
+
+// The terms t * trig((a*x + b*y) * pi/2) of an equation, as separate arrays. The coefficients
+// are stored as int8_t, int16_t or int32_t, so that small ones take up less memory.
+template <typename Coeff>
+struct TermArrays final {
+    const Coeff* t;
+    const Coeff* a;
+    const Coeff* b;
+    size_t size;
+};
+
+// Approximations of the sums over all the terms of
+//
+//     t * trig(theta)
+//     t * a * trig'(theta)
+//     t * b * trig'(theta)
+//
+// together with bounds on their absolute errors. Unlike DoubleInterval, these are calculated
+// with plain round-to-nearest arithmetic, and the rounding errors are accounted for with an
+// explicit error term instead. This is what lets us evaluate several terms per instruction.
+//
+// The derivatives are missing the factor of pi/2 from the chain rule. The curvature is an upper
+// bound on the sum of |t| * (|a| * rx + |b| * ry)^2.
+struct TermSums final {
+    double value;
+    double value_error;
+    double dx;
+    double dx_error;
+    double dy;
+    double dy_error;
+    double curvature;
+};
+
+// sine selects between sin (true) and cos (false). The largest |a| and |b| must be present in
+// x and y respectively, and rx and ry must be upper bounds on the radii.
+template <typename Coeff>
+TermSums sum_terms(const bool sine, const TermArrays<Coeff>& terms,
+                   const PowerArrays& x, const PowerArrays& y,
+                   const double rx, const double ry);
+
+// The portable version of the above, which sum_terms uses on machines without AVX2
+template <typename Coeff>
+TermSums sum_terms_scalar(const bool sine, const TermArrays<Coeff>& terms,
+                          const PowerArrays& x, const PowerArrays& y,
+                          const double rx, const double ry);
+
+// Whether sum_terms uses the AVX2 kernel on this machine
+bool has_avx2_kernel();
+
+extern template TermSums sum_terms(const bool sine, const TermArrays<int8_t>& terms,
+                                   const PowerArrays& x, const PowerArrays& y,
+                                   const double rx, const double ry);
+extern template TermSums sum_terms(const bool sine, const TermArrays<int16_t>& terms,
+                                   const PowerArrays& x, const PowerArrays& y,
+                                   const double rx, const double ry);
+extern template TermSums sum_terms(const bool sine, const TermArrays<int32_t>& terms,
+                                   const PowerArrays& x, const PowerArrays& y,
+                                   const double rx, const double ry);
+
+extern template TermSums sum_terms_scalar(const bool sine, const TermArrays<int8_t>& terms,
+                                          const PowerArrays& x, const PowerArrays& y,
+                                          const double rx, const double ry);
+extern template TermSums sum_terms_scalar(const bool sine, const TermArrays<int16_t>& terms,
+                                          const PowerArrays& x, const PowerArrays& y,
+                                          const double rx, const double ry);
+extern template TermSums sum_terms_scalar(const bool sine, const TermArrays<int32_t>& terms,
+                                          const PowerArrays& x, const PowerArrays& y,
+                                          const double rx, const double ry);
+}
@@ -104,6 +104,18 @@ class LinComMap final {
         }
     }
 
+    void add(const N scale, const LinComMap<T, N>& other) {
+        for (const auto& kv : other) {
+            add(scale * kv.second, kv.first);
+        }
+    }
+
+    void sub(const N scale, const LinComMap<T, N>& other) {
+        for (const auto& kv : other) {
+            sub(scale * kv.second, kv.first);
+        }
+    }
+
     void scale(const N scale) {
 
         if (scale == 0) {
@@ -10,6 +10,7 @@
 class Progress final {
   private:
     std::atomic_uint64_t counter;
+    std::atomic_bool stopped;
     std::thread thrd;
 
     static void pad_right(std::string& str, const size_t len, const char pad) {
@@ -57,7 +58,7 @@ class Progress final {
         return str;
     }
 
-    static void run(std::string msg, const uint64_t total, std::atomic_uint64_t& counter) {
+    static void run(std::string msg, const uint64_t total, std::atomic_uint64_t& counter, std::atomic_bool& stopped) {
 
         using namespace std::chrono_literals;
 
@@ -65,7 +66,7 @@ class Progress final {
 
         pad_right(msg, 20, ' ');
 
-        while (counter != total) {
+        while (counter != total && !stopped) {
 
             const auto now = std::chrono::steady_clock::now();
 
@@ -92,12 +93,18 @@ class Progress final {
   public:
     explicit Progress(const std::string& msg, const uint64_t total)
         : counter{0},
-          thrd{run, msg, total, std::ref(counter)} {}
+          stopped{false},
+          thrd{run, msg, total, std::ref(counter), std::ref(stopped)} {}
 
     void operator++() {
         ++counter;
     }
 
+    // Finish early, for when the rest of the work is not going to be done
+    void stop() {
+        stopped = true;
+    }
+
     ~Progress() {
         thrd.join();
     }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "verify.hpp"
+
+// Checking a cover in several independent processes. Every process works out the same
+// plan_shards, checks its own shard and writes a ShardResult, and merge_shard_results then
+// combines the results of all of the shards into the verdict for the whole cover.
+
+// Shard index of count, written as index/count
+struct Shard final {
+    size_t index;
+    size_t count;
+};
+
+Shard parse_shard(const std::string& str);
+
+// A digest of the files of a cover directory, so that results of a different cover, or of
+// one that has since changed, are not merged
+uint64_t cover_digest(const std::string& dir);
+
+struct ShardResult final {
+    uint64_t cover;
+    Shard shard;
+
+    // The leaves that the shard checked, plus the ones an earlier run of it verified
+    uint64_t leaves;
+    bool covered;
+};
+
+// The file ends with a digest of the rest of it, which load_shard_result checks. This is
+// there to catch files that are truncated, edited or mixed up, it is not a cryptographic
+// signature.
+void write_shard_result(const std::string& file, const ShardResult& result);
+ShardResult load_shard_result(const std::string& file);
+
+// Whether there is exactly one result for every shard of the plan, each for the cover with
+// the given digest and with the leaves that the plan gives it, and every one is covered.
+// Prints what is wrong if not.
+bool merge_shard_results(const std::vector<ShardResult>& results, const uint64_t digest, const std::vector<ShardPlan>& plan);
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+
+#include <boost/optional.hpp>
+
 #include "general.hpp"
 #include "initial_angles.hpp"
 
@@ -44,18 +48,58 @@ struct Edge final {
     }
 };
 
+// The vector between two vertices of an unfolding, x and y
+using PathVector = std::pair<EqMap<Sin>, EqMap<Cos>>;
+
+// A PathVector as one coefficient for each of the terms that any vector of an unfolding can
+// have, see Unfolding
+struct DenseVector final {
+    std::vector<Coeff32> x;
+    std::vector<Coeff32> y;
+};
+
+// The main chain runs through the vertices (1, 0), (2, 0), ..., and each of them can have one or
+// two branches (number, 1) and (number, 2) hanging off it. Any two vertices are joined by the
+// walk along the chain between their numbers, with a branch edge at either end, so the vectors
+// of the chain are kept as prefix sums, and the vector between two vertices is the difference of
+// two of them plus at most two branch edges.
+//
+// The vectors are stored densely, as coefficients of the distinct terms of all of them, so the
+// vector between two vertices is a pass over two flat arrays instead of merging maps.
 class Unfolding final {
   private:
-    std::map<std::pair<Vertex, Vertex>, Edge> edges;
+    // up_edges[k - 1] goes from (k, 0) to (k + 1, 0), and down_edges[k - 1] back
+    std::vector<Edge> up_edges;
+    std::vector<Edge> down_edges;
+
+    // branch_edges[number][branch - 1] goes from (number, 0) out to (number, branch), and back
+    std::vector<std::array<boost::optional<std::pair<Edge, Edge>>, 2>> branch_edges;
+
     std::vector<Vertex> left_vertices;
     std::vector<Vertex> right_vertices;
 
-    std::pair<EqMap<Sin>, EqMap<Cos>> path_vector(const std::vector<Vertex>& path) const;
+    // The terms that the coefficients of a DenseVector are for, in order
+    std::vector<Sin<LinComArrZ<XY>>> sin_terms;
+    std::vector<Cos<LinComArrZ<XY>>> cos_terms;
+
+    // up_sums[k - 1] is the vector from (1, 0) up to (k, 0), and down_sums[k - 1] the one
+    // from (k, 0) down to (1, 0)
+    std::vector<DenseVector> up_sums;
+    std::vector<DenseVector> down_sums;
+
+    // The vectors of branch_edges
+    std::vector<std::array<boost::optional<std::pair<DenseVector, DenseVector>>, 2>> branch_vectors;
+
+    const std::pair<DenseVector, DenseVector>& branch_vector(const Vertex& vertex) const;
+
+    // The vector from start to end, the same as adding up the edges of the walk between them.
+    // This overwrites vector, so that it can be reused from one pair to the next.
+    void pair_vector(const Vertex& start, const Vertex& end, DenseVector& vector) const;
 
   public:
     explicit Unfolding(const std::vector<CodeNumber>& tmp_code_numbers, const std::vector<XYZ>& tmp_code_angles);
 
-    std::pair<EqMap<Sin>, EqMap<Cos>> shooting_vector_general() const;
+    PathVector shooting_vector_general() const;
 
     template <template <typename> class T, template <typename> class S>
     Curves generate_curves(const EqMap<T>& shooting_vector_x, const EqMap<S>& shooting_vector_y, const InitialAngles& initial_angles, const PointQ& center, const Rational& rx, const Rational& ry) const;
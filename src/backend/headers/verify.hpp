@@ -1,10 +1,140 @@
 #pragma once
 
+#include <set>
+#include <string>
+
 #include "cover.hpp"
 #include "equations.hpp"
+#include "info_cache.hpp"
+
+struct VerifyOptions final {
+    // Start the MPFR calculations of each code at estimate_precision, instead of start_bits
+    bool estimate_precision = false;
+
+    // The precision to start the MPFR calculations at. They are doubled until the result is
+    // conclusive, up to the precision given in the cover directory.
+    uint32_t start_bits = 64;
+
+    // Stop checking the cover as soon as any leaf fails
+    bool fail_fast = false;
+
+    // If not empty, write every leaf that fails to this file, sorted by path, once the whole
+    // cover has been checked
+    std::string report_file;
+
+    // If not empty, record every verified subtree in this file, see Journal
+    std::string journal_file;
+
+    // The digest of the cover, which the journal is for. See cover_digest.
+    uint64_t digest = 0;
+
+    // The subtrees that an earlier run verified, which are skipped. See load_journal.
+    std::set<std::string> completed;
+
+    // The subtrees that belong to other shards, which are skipped. See other_shards.
+    std::set<std::string> excluded;
+};
+
+uint64_t count_leaves(const cover::Cover& cover);
+
+// Whether the code proves the whole square, checked exactly the same way as a leaf of the cover,
+// but quietly and without finding out which equation fails. These are for tools that rewrite
+// covers, such as coalesce_cover, which try a lot of squares that are expected to fail.
+bool single_covers_square(const StableInfo& info, const ClosedRectangleQ& square, const uint32_t digits,
+                          const VerifyOptions& options);
+
+bool triple_covers_square(const TripleInfo& info, const TriplePair& triple_pair, const ClosedRectangleQ& square,
+                          const uint32_t digits, const VerifyOptions& options);
+
+// How many leaves use each code in the parts of the cover that are not completed or excluded,
+// which are the only codes that verify_cover needs the infos of. With a path, only count the
+// subtree at that path, for verify_subtree.
+CodeUses count_code_uses(const cover::Cover& cover, const VerifyOptions& options, const std::string& path = "");
 
+// The part of the cover that one process checks, as the paths of its subtrees
+struct ShardPlan final {
+    std::set<std::string> paths;
+    uint64_t leaves = 0;
+    uint64_t cost = 0;
+};
+
+// The paths of the subtrees that a farm hands out, each with at most max_leaves leaves, most
+// expensive first. A large subtree shares the infos of its codes between its leaves, and
+// verify_subtree checks it on every core, so these should be far larger than the work items
+// of verify_cover.
+std::vector<std::string> plan_work(const ClosedRectangleQ& square,
+                                   const std::vector<CodePair>& singles,
+                                   const std::vector<TriplePair>& triples,
+                                   const cover::Cover& cover,
+                                   const uint64_t max_leaves);
+
+// Splits the cover into count shards with about the same estimated cost. This only depends
+// on its arguments, so separate processes agree on which shard has which subtrees.
+std::vector<ShardPlan> plan_shards(const ClosedRectangleQ& square,
+                                   const std::vector<CodePair>& singles,
+                                   const std::vector<TriplePair>& triples,
+                                   const cover::Cover& cover,
+                                   const size_t count);
+
+// The paths of every shard but index, for VerifyOptions::excluded
+std::set<std::string> other_shards(const std::vector<ShardPlan>& shards, const size_t index);
+
+// How much of the cover verify_cover went through, which for a shard should add up to the
+// leaves of its plan
+struct VerifyStats final {
+    // The leaves that were checked, whether or not they were covered
+    uint64_t checked = 0;
+
+    // The leaves of the subtrees that were skipped because an earlier run verified them
+    uint64_t resumed = 0;
+};
+
+// The infos must have been created with count_code_uses of the same cover and options
 bool verify_cover(const ClosedRectangleQ& square, const OpenConvexPolygonQ& polygon,
-                  const std::map<size_t, std::pair<CodePair, StableInfo>>& single_infos,
-                  const std::map<size_t, std::pair<TriplePair, TripleInfo>>& triple_infos,
+                  InfoCache& infos,
                   const cover::Cover& cover,
-                  const uint32_t digits);
+                  const uint32_t digits,
+                  const VerifyOptions& options,
+                  VerifyStats& stats);
+
+// Checks only the subtree of the cover at path (see Journal), without the journal, report or
+// summary of verify_cover. The infos must have been created with count_code_uses of the same
+// path.
+bool verify_subtree(const ClosedRectangleQ& square, const OpenConvexPolygonQ& polygon,
+                    InfoCache& infos,
+                    const cover::Cover& cover,
+                    const std::string& path,
+                    const uint32_t digits,
+                    const VerifyOptions& options);
+
+// Checks the subtrees that a farm worker claims, see run_worker. Every subtree adds its uses
+// to the same InfoCache, so a code is only calculated again if it was freed after the last
+// subtree that needed it, and any number of subtrees can be checked at once.
+class SubtreeVerifier final {
+  private:
+    const ClosedRectangleQ& square;
+    const OpenConvexPolygonQ& polygon;
+    const cover::Cover& cover;
+    const uint32_t digits;
+    const VerifyOptions& options;
+
+    InfoCache infos;
+
+  public:
+    explicit SubtreeVerifier(const ClosedRectangleQ& square_, const OpenConvexPolygonQ& polygon_,
+                             const std::vector<CodePair>& singles,
+                             const std::vector<TriplePair>& triples,
+                             const cover::Cover& cover_,
+                             const uint32_t digits_,
+                             const VerifyOptions& options_,
+                             const InfoStore* const store = nullptr);
+
+    SubtreeVerifier(const SubtreeVerifier&) = delete;
+    SubtreeVerifier& operator=(const SubtreeVerifier&) = delete;
+
+    bool operator()(const std::string& path);
+
+    size_t peak() const {
+        return infos.peak();
+    }
+};
@@ -9,6 +9,11 @@ struct CCodeInfo {
 };
 
 extern "C" {
+// Read the code infos of load_code_info and check_square from the store in the file from now
+// on, see InfoStore. Returns 1 if it was opened, and 0 if there is no such file or it can't be
+// read, in which case the infos are calculated again.
+int32_t open_info_store(const char* const file);
+
 int32_t load_code_info(const char* const code_numbers_ptr,
                        const char* const initial_angles_ptr,
                        CCodeInfo* const c_code_info);
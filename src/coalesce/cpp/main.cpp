@@ -0,0 +1,68 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "coalesce.hpp"
+#include "cover.hpp"
+#include "equations.hpp"
+#include "info_store.hpp"
+#include "verify.hpp"
+
+static void usage(const char* const program) {
+    std::cerr << "usage: " << program << " [--estimate-precision] [--start-bits bits] [--store file] cover-directory output-file" << std::endl;
+}
+
+// Rewrites the cover of a cover directory into one with fewer leaves, see coalesce_cover. The
+// output has the format of cover.txt, and replaces it in a copy of the cover directory.
+int main(const int argc, const char* const argv[]) {
+
+    VerifyOptions options{};
+    std::vector<std::string> positional{};
+
+    std::string store_file{};
+
+    for (int i = 1; i < argc; ++i) {
+
+        const std::string arg{argv[i]};
+
+        if (arg == "--estimate-precision") {
+            options.estimate_precision = true;
+        } else if (arg == "--start-bits" && i + 1 < argc) {
+            options.start_bits = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--store" && i + 1 < argc) {
+            store_file = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() != 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string& cover_dir = positional.at(0);
+    const std::string& output_file = positional.at(1);
+
+    const auto square = load_square(cover_dir);
+    const auto polygon = load_polygon(cover_dir);
+    const auto singles = load_singles(cover_dir);
+    const auto triples = load_triples(cover_dir);
+    const auto cover = load_cover(cover_dir);
+    const auto digits = load_digits(cover_dir);
+
+    const auto store = load_info_store(store_file.empty() ? default_info_store(cover_dir) : store_file);
+
+    CoalesceStats stats{};
+
+    const auto coalesced = coalesce_cover(square, polygon, singles, triples, cover, digits, options, store.get(), stats);
+
+    save_cover(output_file, coalesced);
+
+    std::cout << "Merged " << stats.merged << " divided squares, from " << stats.leaves_before << " to "
+              << stats.leaves_after << " leaves" << std::endl;
+    std::cout << "Wrote the cover to " << output_file << std::endl;
+}
@@ -1,17 +1,131 @@
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "cover.hpp"
 #include "equations.hpp"
+#include "farm.hpp"
+#include "info_store.hpp"
+#include "journal.hpp"
+#include "shard.hpp"
 #include "verify.hpp"
 
+// The largest subtree that a farm hands out. Each one is checked on every core of a worker,
+// and its codes are calculated once for all of its leaves.
+constexpr uint64_t farm_item_leaves = 4096;
+
+static void usage(const char* const program) {
+    std::cerr << "usage: " << program << " [--estimate-precision] [--start-bits bits] [--fail-fast] [--report file] [--journal file] [--resume] [--shard i/N [--result file]] [--store file] cover-directory" << std::endl;
+    std::cerr << "       " << program << " --precompute [--store file] cover-directory" << std::endl;
+    std::cerr << "       " << program << " --merge cover-directory result-file..." << std::endl;
+    std::cerr << "       " << program << " --farm spool-directory cover-directory" << std::endl;
+    std::cerr << "       " << program << " [--estimate-precision] [--start-bits bits] [--store file] [--worker-id id] --worker spool-directory cover-directory" << std::endl;
+}
+
+// Combine the results of every shard of the cover into one verdict
+static int merge(const std::string& cover_dir, const std::vector<std::string>& result_files) {
+
+    const auto square = load_square(cover_dir);
+    const auto singles = load_singles(cover_dir);
+    const auto triples = load_triples(cover_dir);
+    const auto cover = load_cover(cover_dir);
+
+    std::vector<ShardResult> results{};
+
+    for (const auto& file : result_files) {
+        results.push_back(load_shard_result(file));
+    }
+
+    // Every result says how many shards there were, and if they disagree the merge fails
+    const auto count = results.at(0).shard.count;
+    const auto plan = plan_shards(square, singles, triples, cover, count);
+
+    const auto covered = merge_shard_results(results, cover_digest(cover_dir), plan);
+
+    if (covered) {
+        std::cout << "Success: polygon was covered and proved with all equations" << std::endl;
+    } else {
+        std::cout << "Failure: the polygon was not covered" << std::endl;
+    }
+
+    return covered ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(const int argc, const char* const argv[]) {
 
-    if (argc != 2) {
-        std::cerr << "usage: " << argv[0] << " cover-directory" << std::endl;
+    VerifyOptions options{};
+    std::vector<std::string> positional{};
+
+    std::string journal_file{};
+    bool resume = false;
+
+    boost::optional<Shard> shard{};
+    std::string result_file{};
+    bool merge_results = false;
+
+    std::string farm_spool{};
+    std::string worker_spool{};
+    std::string worker_id{};
+
+    std::string store_file{};
+    bool precompute = false;
+
+    for (int i = 1; i < argc; ++i) {
+
+        const std::string arg{argv[i]};
+
+        if (arg == "--estimate-precision") {
+            options.estimate_precision = true;
+        } else if (arg == "--start-bits" && i + 1 < argc) {
+            options.start_bits = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--fail-fast") {
+            options.fail_fast = true;
+        } else if (arg == "--report" && i + 1 < argc) {
+            options.report_file = argv[++i];
+        } else if (arg == "--journal" && i + 1 < argc) {
+            journal_file = argv[++i];
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--shard" && i + 1 < argc) {
+            shard = parse_shard(argv[++i]);
+        } else if (arg == "--result" && i + 1 < argc) {
+            result_file = argv[++i];
+        } else if (arg == "--merge") {
+            merge_results = true;
+        } else if (arg == "--farm" && i + 1 < argc) {
+            farm_spool = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            worker_spool = argv[++i];
+        } else if (arg == "--worker-id" && i + 1 < argc) {
+            worker_id = argv[++i];
+        } else if (arg == "--store" && i + 1 < argc) {
+            store_file = argv[++i];
+        } else if (arg == "--precompute") {
+            precompute = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (merge_results) {
+
+        if (positional.size() < 2) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        return merge(positional.at(0), std::vector<std::string>(positional.begin() + 1, positional.end()));
+    }
+
+    if (positional.size() != 1 || (!shard && !result_file.empty())) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    const std::string cover_dir{argv[1]};
+    const std::string& cover_dir = positional.at(0);
 
     const auto square = load_square(cover_dir);
     const auto polygon = load_polygon(cover_dir);
@@ -20,10 +134,102 @@ int main(const int argc, const char* const argv[]) {
     const auto cover = load_cover(cover_dir);
     const auto digits = load_digits(cover_dir);
 
-    const auto single_infos = load_single_infos(singles);
-    const auto triple_infos = load_triple_infos(triples);
+    // By default, keep the store next to the cover it is for
+    if (store_file.empty()) {
+        store_file = default_info_store(cover_dir);
+    }
 
-    const auto covered = verify_cover(square, polygon, single_infos, triple_infos, cover, digits);
+    if (precompute) {
+
+        // An old or damaged store is what precompute is for, so start over instead of failing
+        std::unique_ptr<const InfoStore> old{};
+
+        try {
+            old = load_info_store(store_file);
+        } catch (const std::exception& e) {
+            std::cout << "Not reusing " << store_file << ": " << e.what() << std::endl;
+        }
+
+        write_info_store(store_file, singles, triples, old.get());
+        return EXIT_SUCCESS;
+    }
+
+    const auto store = load_info_store(store_file);
+
+    if (store) {
+        std::cout << "Reading the infos of " << store->count() << " codes from " << store_file << std::endl;
+    }
+
+    if (!farm_spool.empty()) {
+
+        const auto paths = plan_work(square, singles, triples, cover, farm_item_leaves);
+        const auto covered = run_coordinator(farm_spool, cover_digest(cover_dir), paths, FarmOptions{});
+
+        if (covered) {
+            std::cout << "Success: polygon was covered and proved with all equations" << std::endl;
+        } else {
+            std::cout << "Failure: the polygon was not covered" << std::endl;
+        }
+
+        return covered ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (!worker_spool.empty()) {
+
+        SubtreeVerifier verifier{square, polygon, singles, triples, cover, digits, options, store.get()};
+
+        const auto verify = [&](const std::string& path) {
+            return verifier(path);
+        };
+
+        const auto id = worker_id.empty() ? default_worker_id() : worker_id;
+        const auto checked = run_worker(worker_spool, cover_digest(cover_dir), id, verify, FarmOptions{});
+
+        std::cout << "Worker " << id << " checked " << checked << " subtrees, with at most "
+                  << verifier.peak() << " code infos in memory at once" << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+
+    // Each shard gets its own journal and result, so they can share a directory
+    std::string name{"verify"};
+    std::vector<ShardPlan> plan{};
+
+    if (shard) {
+        name = "shard-" + std::to_string(shard->index) + "-of-" + std::to_string(shard->count);
+
+        plan = plan_shards(square, singles, triples, cover, shard->count);
+        options.excluded = other_shards(plan, shard->index);
+    }
+
+    // By default, keep the journal next to the cover it is for
+    options.journal_file = journal_file.empty() ? cover_dir + "/" + name + ".journal" : journal_file;
+    options.digest = cover_digest(cover_dir);
+
+    if (resume) {
+        options.completed = load_journal(options.journal_file, options.digest);
+    }
+
+    // The infos are calculated as the leaves need them, and only for the subtrees that are
+    // still to be verified
+    InfoCache infos{singles, triples, count_code_uses(cover, options), store.get()};
+
+    VerifyStats stats{};
+
+    const auto covered = verify_cover(square, polygon, infos, cover, digits, options, stats);
+
+    if (shard) {
+
+        const auto file = result_file.empty() ? cover_dir + "/" + name + ".result" : result_file;
+
+        // The leaves that this shard got through, which only match the plan if none were missed
+        write_shard_result(file, ShardResult{options.digest, *shard, stats.checked + stats.resumed, covered});
+
+        std::cout << "Shard " << shard->index << " of " << shard->count << (covered ? " was" : " was not")
+                  << " covered, wrote the result to " << file << std::endl;
+
+        return covered ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
     if (covered) {
         std::cout << "Success: polygon was covered and proved with all equations" << std::endl;
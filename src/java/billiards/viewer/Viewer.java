@@ -383,6 +383,7 @@ public final class Viewer {
             if (dir != null) {
             	clearBtn.fire();
                 currentCover = Optional.of(dir.getPath());
+                Wrapper.openInfoStore(dir.getPath());
 
                 loadCoverAction(dir);
             }
@@ -17,6 +17,14 @@ public final class Wrapper {
         Native.register("backend");
     }
 
+    private static native int open_info_store(String file);
+
+    // Read the code infos from the store that the precompute command wrote into the cover
+    // directory, if it has one, instead of calculating them every time
+    public static boolean openInfoStore(final String coverDir) {
+        return open_info_store(coverDir + "/infos.store") == 1;
+    }
+
     // Strings are very nice, because they don't have a size builtin like int or long or whatever
     private static native int load_code_info(String codeSeqString, String initialAnglesString, CCodeInfo cCodeInfo);
     private static native void cleanup_code_info(CCodeInfo cCodeInfo);
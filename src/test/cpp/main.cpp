@@ -8,10 +8,18 @@
 // Simpler with the build system to include everything in this one file
 // It also compiles faster to have everything in one file
 #include "bounding_region_test.hpp"
+#include "coalesce_test.hpp"
 #include "code_sequence_test.hpp"
 #include "division_test.hpp"
+#include "evaluator_test.hpp"
+#include "farm_test.hpp"
 #include "general_test.hpp"
+#include "info_cache_test.hpp"
+#include "info_store_test.hpp"
+#include "journal_test.hpp"
 #include "gradient_test.hpp"
 #include "parse_test.hpp"
+#include "shard_test.hpp"
 #include "shooting_angles_test.hpp"
 #include "trig_identities_test.hpp"
+#include "unfolding_test.hpp"
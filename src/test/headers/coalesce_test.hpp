@@ -0,0 +1,75 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <coalesce.hpp>
+
+BOOST_AUTO_TEST_CASE(test_coalesce_cover) {
+
+    const std::vector<CodePair> singles{
+        CodePair{CodeSequence{{1, 1, 1}}, InitialAngles{XYZ::X, XYZ::Y}},
+    };
+
+    const std::vector<TriplePair> triples{};
+
+    const OpenConvexPolygonQ polygon{{{{3, 5}, {3, 5}}, {{19, 20}, {3, 5}}, {{3, 5}, {19, 20}}}};
+
+    const VerifyOptions options{};
+
+    const cover::Cover quarters{cover::Divide{cover::Single{0}, cover::Single{0}, cover::Single{0}, cover::Single{0}}};
+
+    // Well inside the triangle of the code, so it proves the whole square, and that merges
+    // all the way up
+    {
+        const ClosedRectangleQ square{{{5, 8}, {7, 8}}, {{5, 8}, {7, 8}}};
+        const cover::Cover cover{cover::Divide{quarters, cover::Single{0}, cover::Single{0}, cover::Empty{}}};
+
+        CoalesceStats stats{};
+        const auto coalesced = coalesce_cover(square, polygon, singles, triples, cover, 30, options, nullptr, stats);
+
+        BOOST_TEST(boost::get<cover::Single>(&coalesced) != nullptr);
+        BOOST_TEST(stats.leaves_before == 7);
+        BOOST_TEST(stats.leaves_after == 1);
+        BOOST_TEST(stats.merged == 2);
+    }
+
+    // Partly outside of the triangle, so nothing can be merged
+    {
+        const ClosedRectangleQ square{{{1, 4}, {3, 4}}, {{1, 4}, {3, 4}}};
+
+        CoalesceStats stats{};
+        const auto coalesced = coalesce_cover(square, polygon, singles, triples, quarters, 30, options, nullptr, stats);
+
+        BOOST_TEST(boost::get<cover::Divide>(&coalesced) != nullptr);
+        BOOST_TEST(stats.leaves_after == 4);
+        BOOST_TEST(stats.merged == 0);
+    }
+
+    // Nowhere near the polygon
+    {
+        const ClosedRectangleQ square{{0, {1, 4}}, {0, {1, 4}}};
+        const cover::Cover cover{cover::Divide{cover::Empty{}, cover::Empty{}, cover::Empty{}, cover::Empty{}}};
+
+        CoalesceStats stats{};
+        const auto coalesced = coalesce_cover(square, polygon, singles, triples, cover, 30, options, nullptr, stats);
+
+        BOOST_TEST(boost::get<cover::Empty>(&coalesced) != nullptr);
+        BOOST_TEST(stats.merged == 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_save_cover) {
+
+    const auto file = "/tmp/test_save_cover." + std::to_string(::getpid());
+
+    const cover::Cover cover{cover::Divide{cover::Single{0},
+                                           cover::Empty{},
+                                           cover::Triple{2},
+                                           cover::Divide{cover::Empty{}, cover::Single{1}, cover::Empty{}, cover::Empty{}}}};
+
+    save_cover(file, cover);
+
+    BOOST_TEST(read_file(file) == "D S 0 E T 2 D E S 1 E E\n");
+
+    std::remove(file.c_str());
+}
@@ -0,0 +1,609 @@
+#pragma once
+
+#include <cmath>
+
+#include <equation_arena.hpp>
+#include <equations.hpp>
+#include <evaluator.hpp>
+#include <math/complex_interval.hpp>
+#include <math/interval_kernel.hpp>
+#include <math/double_interval.hpp>
+#include <parse.hpp>
+
+BOOST_AUTO_TEST_CASE(test_sin_cos_half_pi) {
+
+    // Compare against long double, which is more precise than the enclosures
+    const long double half_pi = 1.570796326794896619231321691639751442L;
+
+    for (int i = -4000; i <= 4000; ++i) {
+
+        // Hit every quadrant, as well as the boundaries between them
+        const double u = i / 250.0;
+
+        const auto sin_cos = math::sin_cos_half_pi(math::DoubleInterval{u, u});
+
+        const auto sin_u = std::sin(u * half_pi);
+        const auto cos_u = std::cos(u * half_pi);
+
+        BOOST_TEST(sin_cos.sin.lower() <= sin_u);
+        BOOST_TEST(sin_u <= sin_cos.sin.upper());
+        BOOST_TEST(sin_cos.sin.upper() - sin_cos.sin.lower() < 1e-12);
+
+        BOOST_TEST(sin_cos.cos.lower() <= cos_u);
+        BOOST_TEST(cos_u <= sin_cos.cos.upper());
+        BOOST_TEST(sin_cos.cos.upper() - sin_cos.cos.lower() < 1e-12);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_is_positive) {
+
+    // equation, center, radius, positive
+    const std::vector<std::tuple<std::string, PointQ, Rational, bool>> input = {
+        {"2cos(0)+cos(x)", {{1, 2}, {1, 2}}, {1, 64}, true},
+        {"cos(x)-2cos(0)", {{1, 2}, {1, 2}}, {1, 64}, false},
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {1, 64}, true},
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {1, 2}, false},
+        {"cos(3x+5y)+cos(0)", {{2, 7}, {3, 11}}, {1, 1024}, true},
+        // The gradient is 0 at the center, so only the second order test can prove this
+        {"3cos(0)-2cos(x)", {0, 0}, {1, 2}, true},
+        {"3cos(0)-2cos(x)", {0, 0}, {1, 1}, false},
+    };
+
+    for (const auto mode : {TrigMode::Reduce, TrigMode::Powers}) {
+
+        Evaluator eval{64, mode};
+
+        for (const auto& tup : input) {
+
+            const auto& string_cos = std::get<0>(tup);
+            const auto& center = std::get<1>(tup);
+            const auto& radius = std::get<2>(tup);
+            const auto positive = std::get<3>(tup);
+
+            const auto expr_cos = parse_lin_com_map_cos_xy(string_cos);
+
+            const auto bounds = gradient_bounds(expr_cos);
+
+            const auto pos = eval.is_positive(expr_cos, bounds.first, bounds.second, center, radius, radius);
+
+            BOOST_TEST(pos == positive);
+        }
+    }
+}
+
+struct EvaluatorTestAccess {
+
+    // The quadrant and fractional part of x_coeff * center.x + y_coeff * center.y
+    static std::pair<unsigned long, Rational> reduce_dyadic(Evaluator& eval, const Coeff64 x_coeff, const Coeff64 y_coeff,
+                                                            const PointQ& center) {
+        const auto quad = eval.reduce_dyadic(x_coeff, y_coeff, center);
+        return {quad, Rational{eval.argq}};
+    }
+
+    static std::pair<unsigned long, Rational> reduce_rational(Evaluator& eval, const Coeff64 x_coeff, const Coeff64 y_coeff,
+                                                              const PointQ& center) {
+        const auto quad = eval.reduce_rational(x_coeff, y_coeff, center);
+        return {quad, Rational{eval.argq}};
+    }
+};
+
+BOOST_AUTO_TEST_CASE(test_reduce_dyadic) {
+
+    const std::vector<PointQ> centers = {
+        // Integer centers, so the exponent is 0
+        {{0, 1}, {0, 1}},
+        {{3, 1}, {-5, 1}},
+        // Different exponents for x and y
+        {{1, 2}, {3, 64}},
+        {{-7, 1024}, {1, 1}},
+        {{5, 8}, {-11, 4}},
+        {{-1, 4096}, {-3, 2}},
+        // Arguments of 4 and more
+        {{9, 2}, {17, 4}},
+        {{-13, 2}, {123, 16}},
+    };
+
+    const std::vector<std::pair<Coeff64, Coeff64>> coeffs = {
+        {0, 0}, {1, 0}, {0, 1}, {1, 1}, {-1, 2}, {3, -5}, {-7, -9}, {100, -1}, {-123456789, 987654321},
+    };
+
+    Evaluator eval{64};
+
+    for (const auto& center : centers) {
+        for (const auto& pair : coeffs) {
+
+            const auto dyadic = EvaluatorTestAccess::reduce_dyadic(eval, pair.first, pair.second, center);
+            const auto rational = EvaluatorTestAccess::reduce_rational(eval, pair.first, pair.second, center);
+
+            BOOST_TEST(dyadic.first == rational.first);
+            BOOST_TEST(dyadic.second == rational.second);
+
+            BOOST_TEST(dyadic.first < 4);
+            BOOST_TEST(0 <= dyadic.second);
+            BOOST_TEST(dyadic.second < 1);
+
+            // The argument is the quadrant plus the fractional part, up to a multiple of 4
+            const Rational arg = pair.first * center.x + pair.second * center.y;
+            const Rational rest = (arg - dyadic.first - dyadic.second) / 4;
+
+            BOOST_TEST(denominator(rest) == 1);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_is_positive_mpfr) {
+
+    // 1 - cos(2^-30 * pi/2) is about 1e-18, far below what the double prefilter can resolve
+    const EquationArena<Cos> positive{{parse_lin_com_map_cos_xy("cos(0)-cos(x)")}, CoeffWidth::Int8};
+    const EquationArena<Cos> negative{{parse_lin_com_map_cos_xy("cos(x)-cos(0)")}, CoeffWidth::Int8};
+
+    const PointQ center{{1, 1073741824}, {-3, 8}};
+
+    // Far smaller than the value, so the first order test passes
+    const Rational radius{1, Integer{1} << 100};
+
+    for (const auto mode : {TrigMode::Reduce, TrigMode::Powers}) {
+
+        Evaluator eval{256, mode};
+
+        BOOST_TEST(!eval.is_positive(negative[0], center, radius, radius));
+
+        eval.clear_precision_histogram();
+
+        BOOST_TEST(eval.is_positive(positive[0], center, radius, radius));
+
+        const auto& histogram = eval.precision_histogram();
+
+        BOOST_TEST(histogram.count(0) == 0);
+        BOOST_TEST(histogram.size() == 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_unit_powers) {
+
+    const long double half_pi = 1.570796326794896619231321691639751442L;
+
+    for (const double x : {0.0, 0.125, 1.0 / 3.0, 0.5, 0.9, 1.0}) {
+
+        const auto sin_cos = math::sin_cos_half_pi(math::DoubleInterval{x, x});
+
+        math::UnitPowers powers{};
+        powers.reset(math::ComplexInterval{sin_cos.cos, sin_cos.sin});
+
+        // The base is only accurate to about 2^-45, and the error grows a bit faster than n
+        for (int64_t n = -300; n <= 300; ++n) {
+
+            const auto power = powers(n);
+
+            // e^{i*n*x*pi/2}
+            const auto re = std::cos(n * x * half_pi);
+            const auto im = std::sin(n * x * half_pi);
+
+            BOOST_TEST(power.re.lower() <= re);
+            BOOST_TEST(re <= power.re.upper());
+            BOOST_TEST(power.re.upper() - power.re.lower() < 1e-9);
+
+            BOOST_TEST(power.im.lower() <= im);
+            BOOST_TEST(im <= power.im.upper());
+            BOOST_TEST(power.im.upper() - power.im.lower() < 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_all_positive) {
+
+    const std::vector<std::string> strings_sin = {
+        "sin(x)+sin(y)",
+        "2sin(x+y)-sin(x-y)",
+        "sin(3x+y)+sin(x)+sin(y)",
+    };
+
+    const std::vector<std::string> strings_cos = {
+        "3cos(0)+cos(x)-cos(y)",
+        "cos(x-y)+cos(x+y)",
+        "cos(3x+y)-cos(x)+2cos(0)",
+    };
+
+    std::set<EqMap<Sin>> sin_equations{};
+    for (const auto& string_sin : strings_sin) {
+        sin_equations.insert(parse_lin_com_map_sin_xy(string_sin));
+    }
+
+    std::set<EqMap<Cos>> cos_equations{};
+    for (const auto& string_cos : strings_cos) {
+        cos_equations.insert(parse_lin_com_map_cos_xy(string_cos));
+    }
+
+    const std::vector<PointQ> points = {{0, 0}, {1, 0}, {0, 1}};
+
+    const StableInfo info{CodeInfo{points, sin_equations, cos_equations}};
+
+    // center, radius
+    const std::vector<std::pair<PointQ, Rational>> input = {
+        {{{1, 4}, {1, 4}}, {1, 64}},
+        {{{1, 4}, {1, 4}}, {1, 4}},
+        {{{1, 3}, {1, 5}}, {1, 1024}},
+        {{{1, 100}, {1, 100}}, {1, 200}},
+        {{{1, 100}, {1, 100}}, {1, 50}},
+        {{{7, 8}, {1, 16}}, {1, 32}},
+    };
+
+    Evaluator eval{64};
+    Evaluator eval_reduce{64, TrigMode::Reduce};
+
+    // Escalating from a tiny precision must not change any results
+    Evaluator eval_escalate{64};
+    eval_escalate.set_start_precision(2);
+
+    for (const auto& pair : input) {
+
+        const auto& center = pair.first;
+        const auto& radius = pair.second;
+
+        // The batched version must agree exactly with checking every equation on its own
+        bool expected = true;
+
+        for (size_t i = 0; i < info.sines.size(); ++i) {
+            expected = expected && eval.is_positive(info.sines[i], center, radius, radius);
+        }
+
+        for (size_t i = 0; i < info.cosines.size(); ++i) {
+            expected = expected && eval.is_positive(info.cosines[i], center, radius, radius);
+        }
+
+        BOOST_TEST(eval.all_positive(info, center, radius, radius) == expected);
+        BOOST_TEST(eval_reduce.all_positive(info, center, radius, radius) == expected);
+        BOOST_TEST(eval_escalate.all_positive(info, center, radius, radius) == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_retire_positive) {
+
+    const std::vector<std::string> strings_sin = {
+        "sin(x)+sin(y)",
+        "2sin(x+y)-sin(x-y)",
+        "sin(3x+y)+sin(x)+sin(y)",
+    };
+
+    const std::vector<std::string> strings_cos = {
+        "3cos(0)+cos(x)-cos(y)",
+        "cos(x-y)+cos(x+y)",
+        "cos(3x+y)-cos(x)+2cos(0)",
+    };
+
+    std::set<EqMap<Sin>> sin_equations{};
+    for (const auto& string_sin : strings_sin) {
+        sin_equations.insert(parse_lin_com_map_sin_xy(string_sin));
+    }
+
+    std::set<EqMap<Cos>> cos_equations{};
+    for (const auto& string_cos : strings_cos) {
+        cos_equations.insert(parse_lin_com_map_cos_xy(string_cos));
+    }
+
+    const std::vector<PointQ> points = {{0, 0}, {1, 0}, {0, 1}};
+
+    const StableInfo info{CodeInfo{points, sin_equations, cos_equations}};
+
+    Evaluator eval{64};
+
+    const PointQ outer_center{{1, 4}, {1, 4}};
+    const Rational outer_radius{1, 4};
+
+    RetiredEquations retired{};
+
+    const auto count = eval.retire_positive(info, outer_center, outer_radius, outer_radius, retired);
+
+    BOOST_TEST(retired.sines.size() == info.sines.size());
+    BOOST_TEST(retired.cosines.size() == info.cosines.size());
+
+    // Some of them hold over the whole square, but not all of them
+    BOOST_TEST(count > 0);
+    BOOST_TEST(count < info.sines.size() + info.cosines.size());
+
+    // Everything that was retired really is positive there
+    for (size_t i = 0; i < info.sines.size(); ++i) {
+        if (retired.sines[i]) {
+            BOOST_TEST(eval.is_positive(info.sines[i], outer_center, outer_radius, outer_radius));
+        }
+    }
+
+    for (size_t i = 0; i < info.cosines.size(); ++i) {
+        if (retired.cosines[i]) {
+            BOOST_TEST(eval.is_positive(info.cosines[i], outer_center, outer_radius, outer_radius));
+        }
+    }
+
+    // Nothing is retired twice
+    BOOST_TEST(eval.retire_positive(info, outer_center, outer_radius, outer_radius, retired) == 0);
+
+    // center, radius, all inside the outer square
+    const std::vector<std::pair<PointQ, Rational>> input = {
+        {{{1, 4}, {1, 4}}, {1, 64}},
+        {{{1, 8}, {1, 8}}, {1, 8}},
+        {{{1, 3}, {1, 5}}, {1, 1024}},
+        {{{1, 100}, {1, 100}}, {1, 200}},
+        {{{3, 8}, {1, 8}}, {1, 16}},
+    };
+
+    // Skipping the retired equations must not change any results
+    for (const auto& pair : input) {
+
+        const auto& center = pair.first;
+        const auto& radius = pair.second;
+
+        BOOST_TEST(eval.all_positive(info, center, radius, radius, retired) == eval.all_positive(info, center, radius, radius));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_interval_kernel) {
+
+    const long double half_pi = 1.570796326794896619231321691639751442L;
+
+    // A fixed pseudo-random sequence, so that failures are reproducible
+    uint64_t state = 12345;
+    const auto next = [&state](const int32_t max) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<int32_t>((state >> 33) % static_cast<uint64_t>(2 * max + 1)) - max;
+    };
+
+    const double cx = 0.3125;
+    const double cy = 0.6875;
+    const double rx = 1.0 / 64;
+    const double ry = 1.0 / 32;
+
+    math::UnitPowers x_powers{};
+    math::UnitPowers y_powers{};
+
+    const auto x_sin_cos = math::sin_cos_half_pi(math::DoubleInterval{cx, cx});
+    const auto y_sin_cos = math::sin_cos_half_pi(math::DoubleInterval{cy, cy});
+
+    x_powers.reset(math::ComplexInterval{x_sin_cos.cos, x_sin_cos.sin});
+    y_powers.reset(math::ComplexInterval{y_sin_cos.cos, y_sin_cos.sin});
+
+    math::PowerArrays x_arrays{};
+    math::PowerArrays y_arrays{};
+
+    BOOST_TEST(x_arrays.extend(x_powers, 40));
+    BOOST_TEST(y_arrays.extend(y_powers, 40));
+
+    // Include sizes that are not a multiple of the vector width
+    for (const size_t size : {1, 3, 4, 7, 16, 33}) {
+
+        std::vector<int32_t> t{};
+        std::vector<int32_t> a{};
+        std::vector<int32_t> b{};
+
+        for (size_t i = 0; i < size; ++i) {
+            t.push_back(next(1000));
+            a.push_back(next(40));
+            b.push_back(next(40));
+        }
+
+        const math::TermArrays<int32_t> terms{t.data(), a.data(), b.data(), size};
+
+        // The same terms stored narrower, which must give exactly the same sums
+        const std::vector<int16_t> t16(std::begin(t), std::end(t));
+        const std::vector<int16_t> a16(std::begin(a), std::end(a));
+        const std::vector<int16_t> b16(std::begin(b), std::end(b));
+
+        const math::TermArrays<int16_t> terms16{t16.data(), a16.data(), b16.data(), size};
+
+        for (const bool sine : {true, false}) {
+
+            long double value = 0;
+            long double dx = 0;
+            long double dy = 0;
+
+            for (size_t i = 0; i < size; ++i) {
+
+                const auto theta = (a.at(i) * static_cast<long double>(cx) + b.at(i) * static_cast<long double>(cy)) * half_pi;
+
+                const auto trig = sine ? std::sin(theta) : std::cos(theta);
+                const auto deriv = sine ? std::cos(theta) : -std::sin(theta);
+
+                value += t.at(i) * trig;
+                dx += t.at(i) * a.at(i) * deriv;
+                dy += t.at(i) * b.at(i) * deriv;
+            }
+
+            const auto scalar = math::sum_terms_scalar(sine, terms, x_arrays, y_arrays, rx, ry);
+            const auto dispatched = math::sum_terms(sine, terms, x_arrays, y_arrays, rx, ry);
+
+            for (const auto& sums : {scalar, dispatched}) {
+
+                BOOST_TEST(std::abs(sums.value - value) <= sums.value_error);
+                BOOST_TEST(std::abs(sums.dx - dx) <= sums.dx_error);
+                BOOST_TEST(std::abs(sums.dy - dy) <= sums.dy_error);
+
+                BOOST_TEST(sums.value_error < 1e-6);
+            }
+
+            BOOST_TEST(dispatched.curvature == scalar.curvature, boost::test_tools::tolerance(1e-12));
+
+            const auto narrow = math::sum_terms(sine, terms16, x_arrays, y_arrays, rx, ry);
+
+            BOOST_TEST(narrow.value == dispatched.value);
+            BOOST_TEST(narrow.value_error == dispatched.value_error);
+            BOOST_TEST(narrow.dx == dispatched.dx);
+            BOOST_TEST(narrow.dy == dispatched.dy);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_equation_arena) {
+
+    BOOST_TEST((narrowest_width(0) == CoeffWidth::Int8));
+    BOOST_TEST((narrowest_width(127) == CoeffWidth::Int8));
+    BOOST_TEST((narrowest_width(128) == CoeffWidth::Int16));
+    BOOST_TEST((narrowest_width(40000) == CoeffWidth::Int32));
+
+    const std::vector<std::string> strings_cos = {
+        "3cos(0)+cos(x)-cos(y)",
+        "100cos(x-2y)+cos(5x+y)",
+        "cos(3x+y)-7cos(x)+2cos(0)",
+    };
+
+    std::set<EqMap<Cos>> equations{};
+    for (const auto& string_cos : strings_cos) {
+        equations.insert(parse_lin_com_map_cos_xy(string_cos));
+    }
+
+    for (const auto width : {CoeffWidth::Int8, CoeffWidth::Int16, CoeffWidth::Int32}) {
+
+        const EquationArena<Cos> arena{equations, width};
+
+        BOOST_TEST(arena.size() == equations.size());
+
+        size_t i = 0;
+
+        for (const auto& equation : equations) {
+
+            const auto eq = arena[i];
+            const auto bounds = gradient_bounds(equation);
+
+            BOOST_TEST(eq.to_map() == equation);
+            BOOST_TEST(eq.bx() == bounds.first);
+            BOOST_TEST(eq.by() == bounds.second);
+
+            ++i;
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_margin) {
+
+    const long double half_pi = 1.570796326794896619231321691639751442L;
+
+    // equation, center, radius, margin
+    const std::vector<std::tuple<std::string, PointQ, Rational, long double>> input = {
+        // cos(0) = 1, and the gradient bounds are both 1
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {1, 64}, 1 - (2.0L / 64) * half_pi},
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {1, 2}, 1 - 1.0L * half_pi},
+        // 2 + cos(pi/4) with bounds 1 and 0
+        {"2cos(0)+cos(x)", {{1, 2}, {1, 2}}, {1, 64}, 2 + std::cos(half_pi / 2) - (1.0L / 64) * half_pi},
+    };
+
+    for (const auto mode : {TrigMode::Reduce, TrigMode::Powers}) {
+
+        Evaluator eval{64, mode};
+
+        for (const auto& tup : input) {
+
+            const auto& center = std::get<1>(tup);
+            const auto& radius = std::get<2>(tup);
+            const auto expected = std::get<3>(tup);
+
+            const EquationArena<Cos> arena{{parse_lin_com_map_cos_xy(std::get<0>(tup))}, CoeffWidth::Int8};
+
+            const auto margin = eval.margin(arena[0], center, radius, radius);
+
+            BOOST_TEST(margin.is_initialized());
+            BOOST_TEST(margin->lower() <= expected);
+            BOOST_TEST(expected <= margin->upper());
+            BOOST_TEST(margin->upper() - margin->lower() < 1e-9);
+
+            // A positive margin means the first order test passes
+            if (margin->lower() > 0) {
+                BOOST_TEST(eval.is_positive(arena[0], center, radius, radius));
+            }
+        }
+    }
+
+    // equation, center, direction, margin along the segment
+    const std::vector<std::tuple<std::string, PointQ, PointQ, long double>> input_along = {
+        // Constant along the segment
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {{1, 2}, {1, 2}}, 1},
+        // |dx - dy| = 1/2
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {{1, 4}, {-1, 4}}, 1 - 0.5L * half_pi},
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {{1, 2}, {-1, 2}}, 1 - 1.0L * half_pi},
+    };
+
+    for (const auto mode : {TrigMode::Reduce, TrigMode::Powers}) {
+
+        Evaluator eval{64, mode};
+
+        for (const auto& tup : input_along) {
+
+            const auto& center = std::get<1>(tup);
+            const auto& dir = std::get<2>(tup);
+            const auto expected = std::get<3>(tup);
+
+            const EquationArena<Cos> arena{{parse_lin_com_map_cos_xy(std::get<0>(tup))}, CoeffWidth::Int8};
+
+            const auto margin = eval.margin_along(arena[0], center, dir.x, dir.y);
+
+            BOOST_TEST(margin.is_initialized());
+            BOOST_TEST(margin->lower() <= expected);
+            BOOST_TEST(expected <= margin->upper());
+            BOOST_TEST(margin->upper() - margin->lower() < 1e-9);
+
+            if (margin->lower() > 0) {
+                BOOST_TEST(eval.is_positive_along(arena[0], center, dir.x, dir.y));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_is_positive_along) {
+
+    // equation, center, direction, positive
+    const std::vector<std::tuple<std::string, PointQ, PointQ, bool>> input = {
+        // Constant along the segment, even though the box around it is far too large
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {{1, 2}, {1, 2}}, true},
+        // Reaches cos(pi/2) = 0 at both ends
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {{1, 2}, {-1, 2}}, false},
+        {"cos(x-y)", {{1, 3}, {1, 3}}, {{1, 4}, {-1, 4}}, true},
+        {"cos(3x+5y)+cos(0)", {{2, 7}, {3, 11}}, {{5, 1024}, {-3, 1024}}, true},
+    };
+
+    for (const auto mode : {TrigMode::Reduce, TrigMode::Powers}) {
+
+        Evaluator eval{64, mode};
+
+        for (const auto& tup : input) {
+
+            const auto& center = std::get<1>(tup);
+            const auto& dir = std::get<2>(tup);
+
+            const EquationArena<Cos> arena{{parse_lin_com_map_cos_xy(std::get<0>(tup))}, CoeffWidth::Int8};
+
+            BOOST_TEST(eval.is_positive_along(arena[0], center, dir.x, dir.y) == std::get<3>(tup));
+        }
+    }
+
+    std::set<EqMap<Sin>> sin_equations{parse_lin_com_map_sin_xy("sin(x)+sin(y)"),
+                                       parse_lin_com_map_sin_xy("2sin(x+y)-sin(x-y)")};
+    std::set<EqMap<Cos>> cos_equations{parse_lin_com_map_cos_xy("cos(x-y)+cos(x+y)"),
+                                       parse_lin_com_map_cos_xy("cos(3x+y)-cos(x)+2cos(0)")};
+
+    const UnstableInfo info{CodeInfo{{{0, 0}, {1, 1}}, sin_equations, cos_equations}};
+
+    const std::vector<std::pair<PointQ, PointQ>> segments = {
+        {{{1, 4}, {1, 4}}, {{1, 8}, {1, 8}}},
+        {{{1, 4}, {1, 4}}, {{1, 4}, {-1, 4}}},
+        {{{1, 3}, {1, 5}}, {{1, 1024}, {0, 1}}},
+        {{{7, 8}, {1, 16}}, {{1, 32}, {1, 16}}},
+    };
+
+    Evaluator eval{64};
+
+    for (const auto& segment : segments) {
+
+        const auto& center = segment.first;
+        const auto& dir = segment.second;
+
+        // The batched version must agree exactly with checking every equation on its own
+        bool expected = true;
+
+        for (size_t i = 0; i < info.sines.size(); ++i) {
+            expected = expected && eval.is_positive_along(info.sines[i], center, dir.x, dir.y);
+        }
+
+        for (size_t i = 0; i < info.cosines.size(); ++i) {
+            expected = expected && eval.is_positive_along(info.cosines[i], center, dir.x, dir.y);
+        }
+
+        BOOST_TEST(eval.all_positive_along(info, center, dir.x, dir.y) == expected);
+    }
+}
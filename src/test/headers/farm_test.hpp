@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <farm.hpp>
+#include <verify.hpp>
+
+BOOST_AUTO_TEST_CASE(test_farm) {
+
+    const auto spool = "/tmp/test_farm." + std::to_string(::getpid());
+
+    const std::vector<std::string> paths{"0", "10", "11", "12", "13", "2", "3"};
+
+    FarmOptions options{};
+    options.heartbeat = std::chrono::milliseconds{20};
+    options.timeout = std::chrono::seconds{2};
+    options.poll = std::chrono::milliseconds{10};
+
+    // A worker that died while it had an item, which must be handed out again
+    ::mkdir(spool.c_str(), 0755);
+    ::mkdir((spool + "/claimed").c_str(), 0755);
+    std::ofstream{spool + "/claimed/0000000001.dead"} << "10";
+
+    std::mutex mutex{};
+    std::multiset<std::string> checked{};
+
+    const auto verify = [&](const std::string& path) {
+        const std::lock_guard<std::mutex> lock{mutex};
+        checked.insert(path);
+        return path != "12";
+    };
+
+    auto coordinator = std::async(std::launch::async, [&] {
+        return run_coordinator(spool, 42, paths, options);
+    });
+
+    auto first = std::async(std::launch::async, [&] {
+        return run_worker(spool, 42, "first", verify, options);
+    });
+
+    auto second = std::async(std::launch::async, [&] {
+        return run_worker(spool, 42, "second", verify, options);
+    });
+
+    // One item fails, so the whole cover does
+    BOOST_TEST(!coordinator.get());
+    BOOST_TEST(first.get() + second.get() == paths.size());
+
+    // Every item was checked, including the one of the dead worker
+    BOOST_TEST((std::set<std::string>(checked.begin(), checked.end()) == std::set<std::string>(paths.begin(), paths.end())));
+
+    // The digest is in hex, the same as in the journal and the shard results
+    std::ifstream farm{spool + "/farm"};
+    const std::string header{std::istreambuf_iterator<char>{farm}, std::istreambuf_iterator<char>{}};
+
+    BOOST_TEST(header.find("cover 000000000000002a\n") != std::string::npos);
+
+    // A worker of a different cover is turned away
+    BOOST_CHECK_THROW(run_worker(spool, 43, "third", verify, options), std::runtime_error);
+
+    BOOST_TEST(std::system(("rm -r " + spool).c_str()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_farm_verify_subtree) {
+
+    const std::vector<CodePair> singles{
+        CodePair{CodeSequence{{1, 1, 1}}, InitialAngles{XYZ::X, XYZ::Y}},
+    };
+
+    const std::vector<TriplePair> triples{};
+
+    // Well inside the triangle of the code, see test_coalesce_cover
+    const ClosedRectangleQ square{{{5, 8}, {7, 8}}, {{5, 8}, {7, 8}}};
+    const OpenConvexPolygonQ polygon{{{{3, 5}, {3, 5}}, {{19, 20}, {3, 5}}, {{3, 5}, {19, 20}}}};
+
+    const cover::Cover quarter{cover::Divide{cover::Single{0}, cover::Single{0}, cover::Single{0}, cover::Single{0}}};
+    const cover::Cover empty{cover::Divide{cover::Empty{}, cover::Empty{}, cover::Empty{}, cover::Empty{}}};
+
+    FarmOptions options{};
+    options.heartbeat = std::chrono::milliseconds{20};
+    options.timeout = std::chrono::seconds{2};
+    options.poll = std::chrono::milliseconds{10};
+
+    const VerifyOptions verify_options{};
+
+    // Runs a coordinator and two workers, each with its own SubtreeVerifier as if it were its
+    // own process, and returns whether the cover was covered
+    const auto farm = [&](const std::string& spool, const cover::Cover& cover) {
+
+        const auto paths = plan_work(square, singles, triples, cover, 4);
+
+        // Every quarter has 4 leaves, so it is handed out whole
+        BOOST_TEST((paths.size() == 4));
+
+        SubtreeVerifier first_verifier{square, polygon, singles, triples, cover, 30, verify_options};
+        SubtreeVerifier second_verifier{square, polygon, singles, triples, cover, 30, verify_options};
+
+        auto coordinator = std::async(std::launch::async, [&] {
+            return run_coordinator(spool, 42, paths, options);
+        });
+
+        auto first = std::async(std::launch::async, [&] {
+            return run_worker(spool, 42, "first", [&](const std::string& path) { return first_verifier(path); }, options);
+        });
+
+        auto second = std::async(std::launch::async, [&] {
+            return run_worker(spool, 42, "second", [&](const std::string& path) { return second_verifier(path); }, options);
+        });
+
+        const auto covered = coordinator.get();
+
+        BOOST_TEST(first.get() + second.get() == paths.size());
+
+        // The only code is calculated at most once per worker, and freed after each subtree
+        BOOST_TEST(first_verifier.peak() <= 1);
+        BOOST_TEST(second_verifier.peak() <= 1);
+
+        BOOST_TEST(std::system(("rm -r " + spool).c_str()) == 0);
+
+        return covered;
+    };
+
+    const auto spool = "/tmp/test_farm_verify_subtree." + std::to_string(::getpid());
+
+    BOOST_TEST(farm(spool, cover::Divide{quarter, quarter, quarter, quarter}));
+
+    // Some of the empty squares are inside the polygon
+    BOOST_TEST(!farm(spool, cover::Divide{quarter, quarter, quarter, empty}));
+
+    // More leaves than one work item, so the equations are retired above the items and the
+    // items only check what is left
+    {
+        const cover::Cover sixteen{cover::Divide{quarter, quarter, quarter, quarter}};
+        const cover::Cover cover{cover::Divide{sixteen, sixteen, sixteen, sixteen}};
+
+        SubtreeVerifier verifier{square, polygon, singles, triples, cover, 30, verify_options};
+
+        BOOST_TEST(verifier(""));
+        BOOST_TEST(verifier("2"));
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <info_cache.hpp>
+
+BOOST_AUTO_TEST_CASE(test_info_cache) {
+
+    const std::vector<CodePair> singles{
+        CodePair{CodeSequence{{1, 1, 1}}, InitialAngles{XYZ::X, XYZ::Y}},
+        CodePair{CodeSequence{{1, 1, 2, 2, 3}}, InitialAngles{XYZ::X, XYZ::Y}},
+    };
+
+    const std::vector<TriplePair> triples{};
+
+    CodeUses uses{};
+    uses.singles[0] = 2;
+
+    InfoCache infos{singles, triples, uses};
+
+    // Both leaves share the same info
+    const auto first = infos.acquire_single(0);
+    const auto second = infos.acquire_single(0);
+
+    BOOST_TEST(first == second);
+    BOOST_TEST(infos.peak() == 1);
+
+    infos.release_single(0);
+    infos.release_single(0);
+
+    // Every use is done, so the cache let go of it
+    BOOST_TEST(first.use_count() == 2);
+    BOOST_CHECK_THROW(infos.acquire_single(0), std::runtime_error);
+
+    // Unused codes are never calculated
+    BOOST_CHECK_THROW(infos.acquire_single(1), std::runtime_error);
+    BOOST_CHECK_THROW(infos.release_single(1), std::runtime_error);
+
+    // Until a use is added for them
+    CodeUses more{};
+    more.singles[1] = 1;
+
+    infos.add_uses(more);
+
+    const auto third = infos.acquire_single(1);
+
+    BOOST_TEST(third != first);
+    BOOST_TEST(infos.peak() == 1);
+
+    infos.release_single(1);
+
+    BOOST_CHECK_THROW(infos.acquire_single(1), std::runtime_error);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <fstream>
+
+#include <unistd.h>
+
+#include <info_store.hpp>
+
+BOOST_AUTO_TEST_CASE(test_info_store) {
+
+    const auto file = "/tmp/test_info_store." + std::to_string(::getpid());
+
+    const CodePair first{CodeSequence{{1, 1, 1}}, InitialAngles{XYZ::X, XYZ::Y}};
+    const CodePair second{CodeSequence{{1, 1, 2, 2, 3}}, InitialAngles{XYZ::X, XYZ::Y}};
+    const CodePair missing{CodeSequence{{1, 1, 1}}, InitialAngles{XYZ::Y, XYZ::Z}};
+
+    // The duplicate is only stored once
+    write_info_store(file, {first, second, first}, {}, nullptr);
+
+    const auto check = [&](const InfoStore& store) {
+
+        BOOST_TEST(store.count() == 2);
+
+        for (const auto& code_pair : {first, second}) {
+
+            const auto stored = store.code_info(code_pair);
+            const auto calculated = calculate_code_info(code_pair);
+
+            BOOST_TEST(stored.is_initialized());
+            BOOST_TEST((stored->points == calculated.points));
+            BOOST_TEST((stored->sin_equations == calculated.sin_equations));
+            BOOST_TEST((stored->cos_equations == calculated.cos_equations));
+        }
+
+        BOOST_TEST(!store.code_info(missing).is_initialized());
+    };
+
+    {
+        const auto store = load_info_store(file);
+        BOOST_TEST((store != nullptr));
+        check(*store);
+
+        // Everything is copied from the old store, even while it is still mapped
+        write_info_store(file, {first, second}, {}, store.get());
+    }
+
+    check(InfoStore{file});
+
+    {
+        std::ofstream output{file};
+        output << "not a store";
+    }
+
+    BOOST_CHECK_THROW(InfoStore{file}, std::runtime_error);
+
+    std::remove(file.c_str());
+
+    BOOST_TEST((load_info_store(file) == nullptr));
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <journal.hpp>
+#include <shard.hpp>
+
+BOOST_AUTO_TEST_CASE(test_journal) {
+
+    const auto file = "/tmp/test_journal." + std::to_string(::getpid());
+
+    // A missing journal has nothing completed
+    std::remove(file.c_str());
+    BOOST_TEST(load_journal(file, 10).empty());
+
+    {
+        Journal journal{file, 10, false};
+        journal.record("");
+        journal.record("03");
+    }
+
+    BOOST_TEST((load_journal(file, 10) == std::set<std::string>{"", "03"}));
+
+    // A journal for a different cover is not used
+    BOOST_CHECK_THROW(load_journal(file, 11), std::runtime_error);
+
+    // A write that was cut off is ignored, and is not added to when appending
+    {
+        std::ofstream output{file, std::ios::app};
+        output << "12";
+    }
+
+    BOOST_TEST((load_journal(file, 10) == std::set<std::string>{"", "03"}));
+
+    {
+        Journal journal{file, 10, true};
+        journal.record("2");
+        journal.flush();
+
+        BOOST_TEST((load_journal(file, 10) == std::set<std::string>{"", "03", "2"}));
+    }
+
+    // Without appending, the journal starts again
+    {
+        Journal journal{file, 10, false};
+    }
+
+    BOOST_TEST(load_journal(file, 10).empty());
+
+    std::remove(file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_journal_cover) {
+
+    const auto dir = "/tmp/test_journal_cover." + std::to_string(::getpid());
+    const auto file = dir + "/verify.journal";
+
+    ::mkdir(dir.c_str(), 0755);
+
+    const auto write_cover = [&](const std::string& stables) {
+        std::ofstream{dir + "/square.txt"} << "0 1 0 1\n";
+        std::ofstream{dir + "/polygon.txt"} << "1/4 1/4\n3/4 1/4\n1/4 3/4\n";
+        std::ofstream{dir + "/stables.txt"} << stables;
+        std::ofstream{dir + "/triples.txt"} << "";
+        std::ofstream{dir + "/cover.txt"} << "D S 0 S 0 S 0 S 0\n";
+        std::ofstream{dir + "/precision.txt"} << "30\n";
+    };
+
+    write_cover("1 1 1\n");
+    const auto before = cover_digest(dir);
+
+    {
+        Journal journal{file, before, false};
+        journal.record("0");
+    }
+
+    BOOST_TEST((load_journal(file, before) == std::set<std::string>{"0"}));
+
+    // The same number of leaves, but a different code, so what was proved no longer holds
+    write_cover("1 2 1 2\n");
+    const auto after = cover_digest(dir);
+
+    BOOST_TEST(after != before);
+    BOOST_CHECK_THROW(load_journal(file, after), std::runtime_error);
+
+    BOOST_TEST(std::system(("rm -r " + dir).c_str()) == 0);
+}
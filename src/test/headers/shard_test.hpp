@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdio>
+#include <fstream>
+
+#include <unistd.h>
+
+#include <shard.hpp>
+
+BOOST_AUTO_TEST_CASE(test_parse_shard) {
+
+    const auto shard = parse_shard("2/5");
+
+    BOOST_TEST(shard.index == 2);
+    BOOST_TEST(shard.count == 5);
+
+    BOOST_CHECK_THROW(parse_shard("5/5"), std::runtime_error);
+    BOOST_CHECK_THROW(parse_shard("1"), std::runtime_error);
+    BOOST_CHECK_THROW(parse_shard("-1/2"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_shard_result) {
+
+    const auto file = "/tmp/test_shard_result." + std::to_string(::getpid());
+
+    const ShardResult result{0x0123456789abcdef, Shard{1, 2}, 37, true};
+
+    write_shard_result(file, result);
+
+    const auto loaded = load_shard_result(file);
+
+    BOOST_TEST(loaded.cover == result.cover);
+    BOOST_TEST(loaded.shard.index == 1);
+    BOOST_TEST(loaded.shard.count == 2);
+    BOOST_TEST(loaded.leaves == 37);
+    BOOST_TEST(loaded.covered);
+
+    // Any change to the result is caught
+    {
+        auto contents = read_file(file);
+        contents.replace(contents.find("covered yes"), 11, "covered no ");
+
+        std::ofstream output{file};
+        output << contents;
+    }
+
+    BOOST_CHECK_THROW(load_shard_result(file), std::runtime_error);
+
+    std::remove(file.c_str());
+
+    std::vector<ShardPlan> plan(2);
+    plan.at(0).leaves = 3;
+    plan.at(1).leaves = 37;
+
+    const ShardResult first{result.cover, Shard{0, 2}, 3, true};
+
+    BOOST_TEST(merge_shard_results({first, result}, result.cover, plan));
+
+    // Missing, duplicated, failed or foreign shards all fail
+    BOOST_TEST(!merge_shard_results({result}, result.cover, plan));
+    BOOST_TEST(!merge_shard_results({first, result, result}, result.cover, plan));
+    BOOST_TEST(!merge_shard_results({first, ShardResult{result.cover, Shard{1, 2}, 37, false}}, result.cover, plan));
+    BOOST_TEST(!merge_shard_results({first, result}, result.cover + 1, plan));
+
+    // A shard that did not get through all of its leaves fails too
+    BOOST_TEST(!merge_shard_results({first, ShardResult{result.cover, Shard{1, 2}, 36, true}}, result.cover, plan));
+}
+
+// The paths of every leaf of the cover, see Journal
+static void leaf_paths(const cover::Cover& cover, const std::string& path, std::vector<std::string>& paths) {
+
+    if (const auto* divide = boost::get<cover::Divide>(&cover)) {
+        for (size_t i = 0; i < 4; ++i) {
+            leaf_paths(divide->quarters.get().at(i), path + static_cast<char>('0' + i), paths);
+        }
+    } else {
+        paths.push_back(path);
+    }
+}
+
+// A full quadtree of the given depth, whose leaves are cheap near the origin and expensive
+// further away, so that the subtrees have different costs
+static cover::Cover synthetic_cover(const size_t depth, const size_t position = 0) {
+
+    if (depth == 0) {
+        if (position % 5 == 0) {
+            return cover::Empty{};
+        }
+
+        return cover::Single{position % 3 == 0 ? size_t{1} : size_t{0}};
+    }
+
+    return cover::Divide{synthetic_cover(depth - 1, 4 * position),
+                         synthetic_cover(depth - 1, 4 * position + 1),
+                         synthetic_cover(depth - 1, 4 * position + 2),
+                         synthetic_cover(depth - 1, 4 * position + 3)};
+}
+
+BOOST_AUTO_TEST_CASE(test_plan_shards) {
+
+    const std::vector<CodePair> singles{
+        CodePair{CodeSequence{{1, 1, 1}}, InitialAngles{XYZ::X, XYZ::Y}},
+        CodePair{CodeSequence{{1, 1, 2, 2, 3}}, InitialAngles{XYZ::X, XYZ::Y}},
+    };
+
+    const std::vector<TriplePair> triples{};
+
+    const ClosedRectangleQ square{{0, 1}, {0, 1}};
+    const auto cover = synthetic_cover(5);
+
+    std::vector<std::string> leaves{};
+    leaf_paths(cover, "", leaves);
+
+    const size_t count = 3;
+    const auto plan = plan_shards(square, singles, triples, cover, count);
+
+    BOOST_TEST(plan.size() == count);
+
+    // Every leaf is in exactly one shard
+    for (const auto& leaf : leaves) {
+
+        size_t owners = 0;
+
+        for (const auto& shard : plan) {
+            for (const auto& path : shard.paths) {
+                if (leaf.compare(0, path.size(), path) == 0) {
+                    ++owners;
+                }
+            }
+        }
+
+        BOOST_TEST(owners == 1);
+    }
+
+    uint64_t total_leaves = 0;
+    uint64_t min_cost = plan.at(0).cost;
+    uint64_t max_cost = plan.at(0).cost;
+
+    for (const auto& shard : plan) {
+        BOOST_TEST(!shard.paths.empty());
+
+        total_leaves += shard.leaves;
+        min_cost = std::min(min_cost, shard.cost);
+        max_cost = std::max(max_cost, shard.cost);
+    }
+
+    BOOST_TEST(total_leaves == leaves.size());
+
+    // Every item has at most 32 leaves, each costing at most 1 + 1 + (1 + 1 + 2 + 2 + 3), and
+    // the greedy split is never further apart than one item
+    BOOST_TEST(max_cost - min_cost <= 32 * 11);
+
+    // Each process works out the plan for itself, so it must always be the same
+    const auto again = plan_shards(square, singles, triples, cover, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        BOOST_TEST((again.at(i).paths == plan.at(i).paths));
+        BOOST_TEST(again.at(i).leaves == plan.at(i).leaves);
+        BOOST_TEST(again.at(i).cost == plan.at(i).cost);
+    }
+
+    BOOST_CHECK_THROW(plan_shards(square, singles, triples, cover, 0), std::runtime_error);
+}
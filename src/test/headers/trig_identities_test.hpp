@@ -101,3 +101,25 @@ BOOST_AUTO_TEST_CASE(test_simplify_cos_xyeta) {
         BOOST_TEST(simplified_expr_pair == expected_out);
     }
 }
+
+BOOST_AUTO_TEST_CASE(test_multiply_lin_com_terms) {
+
+    // Unfolding::generate_curves relies on a product being the sum of the products with each term
+    const auto lin_com_cos = parse_lin_com_map_cos_xy("cos(x-y)-2cos(3x+y)");
+    const auto lin_com_sin = parse_lin_com_map_sin_xy("3sin(y)-sin(2x+y)+sin(2x+3y)");
+
+    const auto expected = multiply_lin_com(lin_com_cos, lin_com_sin);
+
+    LinComMapZ<Sin<LinComArrZ<XY>>> actual{};
+
+    for (const auto& term : lin_com_sin) {
+        actual.add(term.second, multiply_lin_com(lin_com_cos, LinComMapZ<Sin<LinComArrZ<XY>>>{{term.first, 1}}));
+    }
+
+    BOOST_TEST(actual == expected);
+
+    actual.sub(2, expected);
+    actual.add(expected);
+
+    BOOST_TEST(actual.is_zero());
+}
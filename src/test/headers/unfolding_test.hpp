@@ -0,0 +1,50 @@
+#pragma once
+
+#include <tbb/task_arena.h>
+
+#include <equations.hpp>
+#include <unfolding.hpp>
+
+BOOST_AUTO_TEST_CASE(test_generate_curves_threads) {
+
+    const std::vector<CodePair> codes{
+        CodePair{CodeSequence{{1, 1, 2, 2, 3}}, InitialAngles{XYZ::X, XYZ::Y}},
+        CodePair{CodeSequence{{2, 2, 1, 1, 3, 3, 1, 1}}, InitialAngles{XYZ::X, XYZ::Y}},
+    };
+
+    for (const auto& code_pair : codes) {
+
+        // On one thread, the pairs of vertices are gone through in order
+        tbb::task_arena serial{1};
+
+        const auto expected = serial.execute([&] {
+            return calculate_code_info(code_pair);
+        });
+
+        const auto actual = calculate_code_info(code_pair);
+
+        BOOST_TEST((actual.points == expected.points));
+        BOOST_TEST((actual.sin_equations == expected.sin_equations));
+        BOOST_TEST((actual.cos_equations == expected.cos_equations));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_shooting_vector_general) {
+
+    // The prefix sums have to give exactly the vector of adding up the edges of the walk one by one
+    const CodePair code_pair{CodeSequence{{1, 1, 2, 2, 3}}, InitialAngles{XYZ::X, XYZ::Y}};
+
+    const auto code_angles = code_pair.sequence.angles(code_pair.angles);
+    const Unfolding unfold{code_pair.sequence.numbers(), code_angles};
+
+    const auto shooting_vector = unfold.shooting_vector_general();
+
+    std::ostringstream x{};
+    x << shooting_vector.first;
+
+    std::ostringstream y{};
+    y << shooting_vector.second;
+
+    BOOST_TEST(x.str() == "-2sin(y)-sin(3y)+sin(5y)-sin(2x-y)+sin(2x+y)+2sin(2x+3y)-2sin(2x+5y)-sin(4x+3y)+sin(4x+5y)+sin(4x+7y)-sin(4x+9y)-sin(6x+7y)+sin(6x+9y)");
+    BOOST_TEST(y.str() == "-cos(3y)+cos(5y)+cos(2x-y)-cos(2x+y)+2cos(2x+3y)-2cos(2x+5y)-cos(4x+3y)+cos(4x+5y)+cos(4x+7y)-cos(4x+9y)-cos(6x+7y)+cos(6x+9y)");
+}